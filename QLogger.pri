@@ -1,8 +1,40 @@
 INCLUDEPATH += $$PWD
 
 SOURCES += $$PWD/QLogger.cpp \
+    $$PWD/QLoggerBufferPool.cpp \
+    $$PWD/QLoggerCallSite.cpp \
+    $$PWD/QLoggerFlightRecorder.cpp \
+    $$PWD/QLoggerMemoryBudget.cpp \
+    $$PWD/QLoggerPauseBuffer.cpp \
+    $$PWD/QLoggerPeriodicReporter.cpp \
+    $$PWD/QLoggerRetention.cpp \
+    $$PWD/QLoggerRoutingTable.cpp \
+    $$PWD/QLoggerScope.cpp \
+    $$PWD/QLoggerScopeReporter.cpp \
+    $$PWD/QLoggerSharedRing.cpp \
+    $$PWD/QLoggerSocketWriter.cpp \
+    $$PWD/QLoggerStream.cpp \
+    $$PWD/QLoggerVolumeReporter.cpp \
     $$PWD/QLoggerWriter.cpp
 
 HEADERS += $$PWD/QLogger.h \
+    $$PWD/QLoggerBufferPool.h \
+    $$PWD/QLoggerCallSite.h \
+    $$PWD/QLoggerField.h \
+    $$PWD/QLoggerFlightRecorder.h \
+    $$PWD/QLoggerIndex.h \
     $$PWD/QLoggerLevel.h \
+    $$PWD/QLoggerMemoryBudget.h \
+    $$PWD/QLoggerPauseBuffer.h \
+    $$PWD/QLoggerPeriodicReporter.h \
+    $$PWD/QLoggerRecord.h \
+    $$PWD/QLoggerRetention.h \
+    $$PWD/QLoggerRoutingTable.h \
+    $$PWD/QLoggerSampling.h \
+    $$PWD/QLoggerScope.h \
+    $$PWD/QLoggerScopeReporter.h \
+    $$PWD/QLoggerSharedRing.h \
+    $$PWD/QLoggerSocketWriter.h \
+    $$PWD/QLoggerStream.h \
+    $$PWD/QLoggerVolumeReporter.h \
     $$PWD/QLoggerWriter.h
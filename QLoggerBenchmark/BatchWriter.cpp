@@ -0,0 +1,28 @@
+#include "BatchWriter.h"
+
+#include <chrono>
+
+BatchWriter::BatchWriter()
+   : QLogger::QLoggerWriter(QStringLiteral("batch"), QLogger::LogLevel::Trace, QLogger::LogMessageDisplay::Message)
+{
+}
+
+qint64 BatchWriter::nowNs()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+       .count();
+}
+
+void BatchWriter::write(const QVector<QueuedMessage> &messages)
+{
+   if (messages.isEmpty())
+      return;
+
+   const auto now = nowNs();
+
+   for (const auto &message : messages)
+      mLatencies.push_back(now - message.text.toLongLong());
+
+   mWritten.fetch_add(messages.size());
+   mBatches.fetch_add(1);
+}
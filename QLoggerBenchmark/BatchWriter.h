@@ -0,0 +1,47 @@
+#pragma once
+
+/**
+ * @file BatchWriter.h
+ * @brief Destination that measures the batches written by the writer thread instead of writing them.
+ *
+ * @module QLoggerBenchmark
+ */
+#include "QLoggerWriter.h"
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <vector>
+
+/**
+ * @brief The BatchWriter class counts the batches that the writer thread hands to the destination and the latency
+ * of every message. The text of the messages has to be the steady clock time in nanoseconds when they were
+ * enqueued.
+ */
+class BatchWriter : public QLogger::QLoggerWriter
+{
+public:
+   BatchWriter();
+
+   /**
+    * @brief nowNs Gets the steady clock time in nanoseconds used as text of the messages.
+    */
+   static qint64 nowNs();
+
+   quint64 writtenCount() const { return mWritten.load(); }
+   quint64 batchCount() const { return mBatches.load(); }
+
+   /**
+    * @brief latencies Gets the latency of every message in nanoseconds. Only valid once the writer has finished.
+    */
+   std::vector<qint64> latencies() const { return mLatencies; }
+
+protected:
+   void write(const QVector<QueuedMessage> &messages) override;
+   void closeOutput() override { }
+
+private:
+   std::atomic<quint64> mWritten { 0 };
+   std::atomic<quint64> mBatches { 0 };
+   std::vector<qint64> mLatencies;
+};
@@ -0,0 +1,31 @@
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+        BatchWriter.cpp \
+        SocketReceiver.cpp \
+        main.cpp
+
+HEADERS += \
+        BatchWriter.h \
+        SocketReceiver.h
+
+# The socket destination is measured directly, so the internal headers are needed
+INCLUDEPATH += $$PWD/../src $$PWD/../include
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+
+!build_pass:message("QLoggerBenchmark: importing QLogger")
+if( !include($$PWD/../QLogger.pri) ) {
+    error( Could not find the QLogger.pri file. )
+}
@@ -0,0 +1,138 @@
+#include "SocketReceiver.h"
+
+#include <QtEndian>
+
+#if defined(Q_OS_UNIX)
+#   include <poll.h>
+#   include <sys/socket.h>
+#   include <sys/un.h>
+#   include <unistd.h>
+
+#   include <cstring>
+#endif
+
+SocketReceiver::SocketReceiver(const QString &path)
+   : mPath(path.toLocal8Bit())
+{
+}
+
+SocketReceiver::~SocketReceiver()
+{
+   stop();
+}
+
+bool SocketReceiver::start()
+{
+#if defined(Q_OS_UNIX)
+   sockaddr_un address {};
+   address.sun_family = AF_UNIX;
+
+   if (mPath.size() >= static_cast<int>(sizeof(address.sun_path)))
+      return false;
+
+   std::memcpy(address.sun_path, mPath.constData(), mPath.size());
+   ::unlink(mPath.constData());
+
+   mServer = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+   if (mServer < 0 || ::bind(mServer, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+       || ::listen(mServer, 4) != 0)
+   {
+      stop();
+      return false;
+   }
+
+   mQuit.store(false);
+   mThread = std::thread([this]() { run(); });
+
+   return true;
+#else
+   return false;
+#endif
+}
+
+void SocketReceiver::stop()
+{
+   mQuit.store(true);
+
+   if (mThread.joinable())
+      mThread.join();
+
+#if defined(Q_OS_UNIX)
+   if (mServer >= 0)
+   {
+      ::close(mServer);
+      ::unlink(mPath.constData());
+   }
+#endif
+
+   mServer = -1;
+}
+
+void SocketReceiver::run()
+{
+#if defined(Q_OS_UNIX)
+   while (!mQuit.load())
+   {
+      pollfd server { mServer, POLLIN, 0 };
+
+      if (::poll(&server, 1, 50) <= 0)
+         continue;
+
+      const auto client = ::accept(mServer, nullptr, nullptr);
+
+      if (client >= 0)
+      {
+         readConnection(client);
+         ::close(client);
+      }
+   }
+#endif
+}
+
+void SocketReceiver::readConnection(int client)
+{
+#if defined(Q_OS_UNIX)
+   QByteArray buffer;
+   char chunk[64 * 1024];
+
+   while (!mQuit.load())
+   {
+      if (mStalled.load())
+      {
+         ::usleep(10 * 1000);
+         continue;
+      }
+
+      pollfd connection { client, POLLIN, 0 };
+
+      if (::poll(&connection, 1, 50) <= 0)
+         continue;
+
+      const auto size = ::read(client, chunk, sizeof(chunk));
+
+      // The writer closed the connection
+      if (size <= 0)
+         return;
+
+      buffer.append(chunk, static_cast<int>(size));
+
+      auto position = 0;
+
+      while (buffer.size() - position >= 4)
+      {
+         const auto length = qFromBigEndian<quint32>(buffer.constData() + position);
+
+         if (buffer.size() - position - 4 < static_cast<int>(length))
+            break;
+
+         position += 4 + static_cast<int>(length);
+         mReceived.fetch_add(1);
+      }
+
+      buffer.remove(0, position);
+   }
+#else
+   Q_UNUSED(client)
+#endif
+}
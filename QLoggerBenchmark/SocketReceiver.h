@@ -0,0 +1,56 @@
+#pragma once
+
+/**
+ * @file SocketReceiver.h
+ * @brief Minimal stand-in for a log collector used to measure the socket destination.
+ *
+ * @module QLoggerBenchmark
+ */
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief The SocketReceiver class listens on a Unix domain socket, reads length prefixed messages and counts them.
+ * It can be stalled to measure how the socket destination behaves when the receiver stops reading.
+ */
+class SocketReceiver
+{
+public:
+   explicit SocketReceiver(const QString &path);
+   ~SocketReceiver();
+
+   /**
+    * @brief start Creates the socket and starts reading in a thread.
+    * @return True if the socket could be created.
+    */
+   bool start();
+
+   /**
+    * @brief stop Stops the thread and removes the socket.
+    */
+   void stop();
+
+   /**
+    * @brief setStalled Stops or resumes reading from the connection.
+    */
+   void setStalled(bool stalled) { mStalled.store(stalled); }
+
+   /**
+    * @brief receivedCount Gets the amount of complete messages received.
+    */
+   quint64 receivedCount() const { return mReceived.load(); }
+
+private:
+   QByteArray mPath;
+   int mServer = -1;
+   std::thread mThread;
+   std::atomic<bool> mQuit { false };
+   std::atomic<bool> mStalled { false };
+   std::atomic<quint64> mReceived { 0 };
+
+   void run();
+   void readConnection(int client);
+};
@@ -0,0 +1,914 @@
+/**
+ * @file main.cpp
+ * @brief Benchmarks and checks of the QLogger hot path.
+ *
+ * @module QLoggerBenchmark
+ */
+#include <QCoreApplication>
+
+#include "QLogger.h"
+#include "QLoggerSharedRing.h"
+#include "QLoggerSocketWriter.h"
+#include "QLoggerWriter.h"
+#include "SocketReceiver.h"
+#include "BatchWriter.h"
+
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSet>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+#endif
+
+namespace
+{
+/**
+ * @brief Heap allocations done by the current thread while the counting is enabled. Only the thread that logs is
+ * measured, the writer threads are not.
+ */
+thread_local bool tlsCountAllocations = false;
+thread_local quint64 tlsAllocations = 0;
+
+inline void countAllocation()
+{
+   if (tlsCountAllocations)
+      ++tlsAllocations;
+}
+}
+
+#if defined(__GLIBC__)
+// Qt containers allocate with malloc, so it has to be intercepted as well as operator new
+extern "C" void *malloc(size_t size)
+{
+   countAllocation();
+   return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+   countAllocation();
+   return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+   countAllocation();
+   return __libc_realloc(ptr, size);
+}
+#endif
+
+void *operator new(std::size_t size)
+{
+#if !defined(__GLIBC__)
+   countAllocation();
+#endif
+   if (const auto ptr = std::malloc(size ? size : 1))
+      return ptr;
+
+   throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+   std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+   std::free(ptr);
+}
+
+using namespace QLogger;
+
+namespace
+{
+const QString kModule = QStringLiteral("QLoggerBenchmark");
+
+/**
+ * @brief Counts the heap allocations done by the calling thread for each QLog_Debug call once the logger is warmed
+ * up. The burst is smaller than the buffer pool so the writer can recycle all the buffers between bursts.
+ * @return True if there are no allocations in steady state.
+ */
+bool allocationsPerLogCall()
+{
+   static const int kBurst = 1000;
+   static const int kRounds = 5;
+
+   const auto logBurst = []() {
+      for (auto i = 0; i < kBurst; ++i)
+         QLog_Debug(kModule, QStringLiteral("Allocation check message of a typical size for a debug line"));
+   };
+
+   // Warm up: registers the call site and grows the queues and the buffer pool
+   for (auto round = 0; round < 3; ++round)
+   {
+      logBurst();
+      QThread::msleep(200);
+   }
+
+   quint64 allocations = 0;
+
+   for (auto round = 0; round < kRounds; ++round)
+   {
+      tlsAllocations = 0;
+      tlsCountAllocations = true;
+
+      logBurst();
+
+      tlsCountAllocations = false;
+      allocations += tlsAllocations;
+
+      QThread::msleep(200);
+   }
+
+   const auto perCall = static_cast<double>(allocations) / (kBurst * kRounds);
+
+   qInfo().noquote() << QString("Allocations per log call: %1 (%2 in %3 calls)")
+                            .arg(perCall)
+                            .arg(allocations)
+                            .arg(kBurst * kRounds);
+
+   return allocations == 0;
+}
+
+/**
+ * @brief Compares the heap allocations per call of a message built with QString concatenation and of the same
+ * message built with QLog_DebugS. A disabled streaming call must not evaluate its operands, and neither must an
+ * enabled call site that streams to a module whose destination has a higher level.
+ * @return True if the streamed message only allocates the final text and the disabled and filtered calls do nothing.
+ */
+bool streamingBuilder()
+{
+   static const int kCalls = 1000;
+
+   const auto userId = 4242;
+   const auto elapsed = 17.5;
+
+   const auto countCalls = [](const std::function<void(int)> &call) {
+      // Warm up: registers the call site
+      call(0);
+      QThread::msleep(200);
+
+      tlsAllocations = 0;
+      tlsCountAllocations = true;
+
+      for (auto i = 0; i < kCalls; ++i)
+         call(i);
+
+      tlsCountAllocations = false;
+
+      QThread::msleep(200);
+
+      return static_cast<double>(tlsAllocations) / kCalls;
+   };
+
+   const auto concatenated = countCalls([&](int i) {
+      QLog_Debug(kModule,
+                 QStringLiteral("user ") + QString::number(userId) + QStringLiteral(" request ") + QString::number(i)
+                     + QStringLiteral(" took ") + QString::number(elapsed) + QStringLiteral("ms"));
+   });
+
+   const auto streamed = countCalls(
+       [&](int i) { QLog_DebugS(kModule) << "user " << userId << " request " << i << " took " << elapsed << "ms"; });
+
+   auto evaluated = 0;
+   const auto disabled = countCalls([&](int) { QLog_TraceS(kModule) << "never " << ++evaluated; });
+
+   const auto warningModule = QStringLiteral("QLoggerBenchmark.streamWarning");
+
+   QLoggerManager::getInstance()->addDestination(QStringLiteral("stream.log"), warningModule, LogLevel::Warning,
+                                                 QDir::tempPath() + QStringLiteral("/QLoggerBenchmark"),
+                                                 LogMode::OnlyFile, LogFileDisplay::Number,
+                                                 LogMessageDisplay::Default, false);
+
+   const auto filtered = countCalls([&](int) { QLog_DebugS(warningModule) << "never " << ++evaluated; });
+
+   qInfo().noquote() << QString("Allocations per call: concatenated %1, streamed %2, disabled %3, filtered %4")
+                            .arg(concatenated)
+                            .arg(streamed)
+                            .arg(disabled)
+                            .arg(filtered);
+
+   return streamed <= 1 && disabled == 0 && filtered == 0 && evaluated == 0;
+}
+
+/**
+ * @brief Fills the memory budget with the queue of a writer that is not running yet. Debug messages have to be
+ * dropped once the unreserved part of the budget is full, while Error messages still fit in the reserved part.
+ * @return True if the usage never goes over the budget, the Error message is queued and all the memory is given
+ * back once the writer has written the queue.
+ */
+bool memoryBudget()
+{
+   static const qint64 kBudget = 1024 * 1024;
+
+   const auto manager = QLoggerManager::getInstance();
+   const auto usedBefore = manager->getMemoryStatistics().used;
+
+   manager->setMemoryBudget(usedBefore + kBudget);
+
+   QLoggerWriter writer(QStringLiteral("budget.log"), LogLevel::Trace,
+                        QDir::tempPath() + QStringLiteral("/QLoggerBenchmark"));
+
+   const auto text = QStringLiteral("[Debug][QLoggerBenchmark][1700000000][0x1] Message that waits in the queue");
+
+   for (auto i = 0; i < 100000; ++i)
+      writer.enqueue(text, LogLevel::Debug);
+
+   const auto flooded = manager->getMemoryStatistics();
+
+   writer.enqueue(QStringLiteral("Error message that uses the reserved memory"), LogLevel::Error);
+
+   const auto afterError = manager->getMemoryStatistics();
+
+   writer.start();
+   writer.closeDestination();
+   writer.wait();
+
+   const auto drained = manager->getMemoryStatistics();
+
+   manager->setMemoryBudget(0);
+
+   qInfo().noquote() << QString("Memory budget: %1 of %2 bytes used, high-water %3, %4 messages dropped")
+                            .arg(flooded.used - usedBefore)
+                            .arg(kBudget)
+                            .arg(afterError.highWater)
+                            .arg(flooded.dropped);
+
+   return flooded.used <= flooded.limit && flooded.dropped > 0 && afterError.dropped == flooded.dropped
+       && afterError.used > flooded.used && drained.used == usedBefore;
+}
+
+/**
+ * @brief Measures the cost of a QLog_Scope and checks that measuring a scope doesn't allocate memory. The summary
+ * is written with reportScopes.
+ * @return True if there are no allocations once the scope site is registered.
+ */
+bool scopeTiming()
+{
+   static const int kScopes = 1000000;
+
+   const auto measured = []() { QLog_Scope(kModule, QStringLiteral("benchmark")); };
+
+   // Warm up: registers the scope site
+   measured();
+
+   QElapsedTimer timer;
+   timer.start();
+
+   tlsAllocations = 0;
+   tlsCountAllocations = true;
+
+   for (auto i = 0; i < kScopes; ++i)
+      measured();
+
+   tlsCountAllocations = false;
+
+   const auto elapsedNs = timer.nsecsElapsed();
+   const auto allocations = tlsAllocations;
+
+   QLoggerManager::getInstance()->reportScopes();
+
+   qInfo().noquote() << QString("Scope timing: %1 ns per scope, %2 allocations in %3 scopes")
+                            .arg(static_cast<double>(elapsedNs) / kScopes, 0, 'f', 1)
+                            .arg(allocations)
+                            .arg(kScopes);
+
+   return allocations == 0;
+}
+
+/**
+ * @brief Measures the cost of logging while paused with a pause buffer small enough to spill to disk, the time that
+ * resume takes to return and the time to drain the buffer in the background.
+ * @return True if no message is dropped and the buffer is drained after resume.
+ */
+bool pauseBuffer()
+{
+   static const int kMessages = 200000;
+
+   const auto manager = QLoggerManager::getInstance();
+   const auto text = QStringLiteral("Message logged while the destinations are paused");
+
+   manager->setPauseBuffer(1024 * 1024, 256 * 1024 * 1024);
+   manager->pause();
+
+   QElapsedTimer timer;
+   timer.start();
+
+   for (auto i = 0; i < kMessages; ++i)
+      QLog_Info(kModule, text);
+
+   const auto pausedNs = timer.nsecsElapsed();
+   const auto paused = manager->getPauseStatistics();
+
+   timer.restart();
+   manager->resume();
+
+   const auto resumeMs = timer.elapsed();
+   const QDeadlineTimer deadline(30000);
+   auto resumed = manager->getPauseStatistics();
+
+   while (resumed.buffered > 0 && !deadline.hasExpired())
+   {
+      QThread::msleep(10);
+      resumed = manager->getPauseStatistics();
+   }
+
+   const auto drainMs = timer.elapsed();
+
+   manager->setPauseBuffer(0);
+
+   qInfo().noquote() << QString("Pause buffer: %1 ns per paused message, %2 of %3 messages spilled, resumed in %4 ms, "
+                                "drained in %5 ms")
+                            .arg(static_cast<double>(pausedNs) / kMessages, 0, 'f', 1)
+                            .arg(paused.spilled)
+                            .arg(paused.buffered)
+                            .arg(resumeMs)
+                            .arg(drainMs);
+
+   return paused.buffered == static_cast<quint64>(kMessages) && paused.spilled > 0 && paused.dropped == 0
+       && resumed.buffered == 0 && resumed.dropped == 0;
+}
+
+/**
+ * @brief Measures the time to register destinations for an increasing amount of modules. The destinations are
+ * started lazily, so registering them must not create their folder; the first message does. The routing table is
+ * updated in place, so the cost per module has to stay flat as the amount of modules grows.
+ * @return True if no folder is created until a module logs, the first message creates it and registering 10000
+ * modules doesn't cost much more per module than registering 100.
+ */
+bool destinationStartup()
+{
+   const auto manager = QLoggerManager::getInstance();
+   auto success = true;
+   QVector<double> perModuleUs;
+
+   for (const auto modules : { 10, 100, 1000, 10000 })
+   {
+      const auto folder = QDir::tempPath() + QStringLiteral("/QLoggerBenchmarkStartup%1").arg(modules);
+      const auto prefix = QStringLiteral("QLoggerBenchmark.startup%1.").arg(modules);
+
+      QDir(folder).removeRecursively();
+
+      QElapsedTimer timer;
+      timer.start();
+
+      for (auto i = 0; i < modules; ++i)
+      {
+         manager->addDestination(QStringLiteral("module%1.log").arg(i), prefix + QString::number(i), LogLevel::Info,
+                                 folder);
+      }
+
+      const auto registerUs = timer.nsecsElapsed() / 1000;
+      const auto createdEarly = QDir(folder).exists();
+
+      perModuleUs.append(static_cast<double>(registerUs) / modules);
+
+      timer.restart();
+      QLog_Info(prefix + QStringLiteral("0"), QStringLiteral("First message of the module"));
+      const auto firstMessageUs = timer.nsecsElapsed() / 1000;
+
+      const QDeadlineTimer deadline(2000);
+      const auto filePath = folder + QStringLiteral("/module0.log");
+
+      while (!QFile::exists(filePath) && !deadline.hasExpired())
+         QThread::msleep(1);
+
+      qInfo().noquote() << QString("Destination startup (%1 modules): %2 us to register, %3 us per module, "
+                                   "first message %4 us")
+                               .arg(modules)
+                               .arg(registerUs)
+                               .arg(perModuleUs.constLast(), 0, 'f', 1)
+                               .arg(firstMessageUs);
+
+      success &= !createdEarly && QFile::exists(filePath);
+   }
+
+   // Rebuilding the routes on every registration made it grow linearly, 100 times from 100 to 10000 modules
+   const auto growth = perModuleUs.constLast() / qMax(perModuleUs.at(1), 0.1);
+
+   qInfo().noquote() << QString("Destination startup: the cost per module grows %1 times from 100 to 10000 modules")
+                            .arg(growth, 0, 'f', 1);
+
+   return success && growth < 4.0;
+}
+
+/**
+ * @brief Measures how the batch delay of the writer trades latency for throughput. For every delay, a burst of
+ * messages measures the throughput and the batch size, and a slow trickle of messages measures the latency when the
+ * writer is idle.
+ * @return True if all the messages are written with every delay.
+ */
+bool batchDelay()
+{
+   static const int kBurst = 200000;
+   static const int kTrickle = 200;
+
+   const auto percentile = [](std::vector<qint64> values, double fraction) {
+      if (values.empty())
+         return 0.0;
+
+      const auto index = static_cast<size_t>(fraction * (values.size() - 1));
+      std::nth_element(values.begin(), values.begin() + index, values.end());
+
+      return values[index] / 1000.0;
+   };
+
+   auto success = true;
+
+   for (const auto delay : { 0, 50, 200, 1000 })
+   {
+      BatchWriter burstWriter;
+      burstWriter.setBatchDelay(delay);
+      burstWriter.start();
+
+      QElapsedTimer timer;
+      timer.start();
+
+      for (auto i = 0; i < kBurst; ++i)
+         burstWriter.enqueue(QString::number(BatchWriter::nowNs()), LogLevel::Info);
+
+      burstWriter.closeDestination();
+      burstWriter.wait();
+
+      const auto elapsedMs = qMax<qint64>(timer.elapsed(), 1);
+
+      BatchWriter trickleWriter;
+      trickleWriter.setBatchDelay(delay);
+      trickleWriter.start();
+
+      for (auto i = 0; i < kTrickle; ++i)
+      {
+         trickleWriter.enqueue(QString::number(BatchWriter::nowNs()), LogLevel::Info);
+         QThread::usleep(500);
+      }
+
+      trickleWriter.closeDestination();
+      trickleWriter.wait();
+
+      const auto batches = qMax<quint64>(burstWriter.batchCount(), 1);
+
+      qInfo().noquote() << QString("Batch delay %1 us: %2 msg/s, %3 msg/batch, burst latency p50 %4 us, "
+                                   "idle latency p50 %5 us, p99 %6 us")
+                               .arg(delay)
+                               .arg(kBurst * 1000 / elapsedMs)
+                               .arg(burstWriter.writtenCount() / batches)
+                               .arg(percentile(burstWriter.latencies(), 0.5), 0, 'f', 1)
+                               .arg(percentile(trickleWriter.latencies(), 0.5), 0, 'f', 1)
+                               .arg(percentile(trickleWriter.latencies(), 0.99), 0, 'f', 1);
+
+      success &= burstWriter.writtenCount() == kBurst && trickleWriter.writtenCount() == kTrickle;
+   }
+
+   return success;
+}
+
+/**
+ * @brief Checks that a producer that stalls after reserving a slot of the shared ring doesn't block it: the
+ * collector skips the slot, the producer drops its record when it resumes, and the ring keeps working for several
+ * laps.
+ * @return True if the stalled record is dropped and every other record is received in order.
+ */
+bool sharedRingStall()
+{
+   static const int kLaps = 5;
+   static const int kSlots = 4;
+
+   const auto key = QStringLiteral("QLoggerBenchmark.ring.%1").arg(QCoreApplication::applicationPid());
+   QLoggerSharedRing collector(key);
+   QLoggerSharedRing producer(key);
+
+   if (!collector.create(kSlots) || !producer.attach())
+   {
+      qInfo() << "Shared ring stall: cannot create the ring";
+      return false;
+   }
+
+   QLoggerRecord record;
+   record.message = QStringLiteral("Shared ring message");
+
+   quint64 stalled = 0;
+   producer.reserve(stalled);
+
+   record.sequence = 1;
+   auto success = producer.push(record);
+
+   // The collector waits for the stalled slot and then skips it
+   QElapsedTimer timer;
+   timer.start();
+
+   QLoggerRecord received;
+   auto isReceived = false;
+
+   while (!isReceived && timer.elapsed() < 5000)
+   {
+      isReceived = collector.pop(received);
+
+      if (!isReceived)
+         QThread::msleep(10);
+   }
+
+   const auto skippedMs = timer.elapsed();
+
+   success &= isReceived && received.sequence == 1;
+
+   // The producer resumes after its slot has been skipped
+   success &= !producer.publish(stalled, record);
+
+   for (quint64 i = 0; i < kLaps * kSlots; ++i)
+   {
+      record.sequence = 2 + i;
+      success &= producer.push(record) && collector.pop(received) && received.sequence == record.sequence;
+   }
+
+   qInfo().noquote() << QString("Shared ring stall: slot skipped after %1 ms, %2 dropped")
+                            .arg(skippedMs)
+                            .arg(collector.getDroppedCount());
+
+   return success && collector.getDroppedCount() == 1;
+}
+
+/**
+ * @brief Checks that two modules stored in the same file keep every message while the file is rotated. The modules
+ * share the writer of the file, so only one handle appends to it and rotates it.
+ * @return True if every message is written exactly once and the file has been rotated.
+ */
+bool sharedFileRotation()
+{
+   static const int kMessages = 20000;
+
+   const auto manager = QLoggerManager::getInstance();
+   const auto folder = QDir::tempPath() + QStringLiteral("/QLoggerBenchmarkShared");
+   const QStringList modules { QStringLiteral("QLoggerBenchmark.sharedA"), QStringLiteral("QLoggerBenchmark.sharedB") };
+
+   QDir(folder).removeRecursively();
+
+   // A small file size forces several rotations
+   manager->setDefaultMaxFileSize(16 * 1024);
+   manager->addDestination(QStringLiteral("shared.log"), modules, LogLevel::Trace, folder, LogMode::OnlyFile,
+                           LogFileDisplay::Number, LogMessageDisplay::Default, false);
+   manager->setDefaultMaxFileSize(64 * 1024 * 1024);
+
+   for (auto i = 0; i < kMessages; ++i)
+      QLog_Info(modules.at(i % 2), QStringLiteral("Shared file message %1").arg(i));
+
+   const auto countMessages = [&folder](QSet<int> &numbers) {
+      auto lines = 0;
+      const auto files = QDir(folder).entryInfoList({ QStringLiteral("*.log") }, QDir::Files);
+
+      for (const auto &info : files)
+      {
+         QFile file(info.absoluteFilePath());
+
+         if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            continue;
+
+         while (!file.atEnd())
+         {
+            const auto line = QString::fromUtf8(file.readLine());
+            const auto position = line.indexOf(QStringLiteral("Shared file message "));
+
+            if (position >= 0)
+            {
+               numbers.insert(line.mid(position + 20).trimmed().toInt());
+               ++lines;
+            }
+         }
+      }
+
+      return lines;
+   };
+
+   QSet<int> numbers;
+   auto lines = 0;
+   const QDeadlineTimer deadline(5000);
+
+   do
+   {
+      QThread::msleep(10);
+      numbers.clear();
+      lines = countMessages(numbers);
+   } while (lines < kMessages && !deadline.hasExpired());
+
+   const auto files = QDir(folder).entryList({ QStringLiteral("*.log") }, QDir::Files).count();
+
+   qInfo().noquote() << QString("Shared file rotation: %1 of %2 messages in %3 files, %4 distinct")
+                            .arg(lines)
+                            .arg(kMessages)
+                            .arg(files)
+                            .arg(numbers.count());
+
+   return lines == kMessages && numbers.count() == kMessages && files > 1;
+}
+
+/**
+ * @brief Stores a module at Warning and another one at Debug in the same file. Each module keeps its own level even
+ * though they share the writer, and a third module that asks for another mode is refused.
+ * @return True if only the Debug message of the second module is written and the conflicting module is refused.
+ */
+bool sharedFileLevels()
+{
+   const auto manager = QLoggerManager::getInstance();
+   const auto folder = QDir::tempPath() + QStringLiteral("/QLoggerBenchmarkLevels");
+   const auto warningModule = QStringLiteral("QLoggerBenchmark.levelsWarning");
+   const auto debugModule = QStringLiteral("QLoggerBenchmark.levelsDebug");
+
+   QDir(folder).removeRecursively();
+
+   manager->addDestination(QStringLiteral("levels.log"), warningModule, LogLevel::Warning, folder, LogMode::OnlyFile,
+                           LogFileDisplay::Number, LogMessageDisplay::Default, false);
+   manager->addDestination(QStringLiteral("levels.log"), debugModule, LogLevel::Debug, folder, LogMode::OnlyFile,
+                           LogFileDisplay::Number, LogMessageDisplay::Default, false);
+
+   const auto isConflictRefused = !manager->addDestination(
+       QStringLiteral("levels.log"), QStringLiteral("QLoggerBenchmark.levelsConflict"), LogLevel::Debug, folder,
+       LogMode::Full, LogFileDisplay::Number, LogMessageDisplay::Default, false);
+
+   QLog_Debug(warningModule, QStringLiteral("Levels message from the Warning module"));
+   QLog_Debug(debugModule, QStringLiteral("Levels message from the Debug module"));
+   QLog_Warning(warningModule, QStringLiteral("Levels message, last one"));
+
+   QString content;
+   const QDeadlineTimer deadline(5000);
+
+   do
+   {
+      QThread::msleep(10);
+
+      QFile file(folder + QStringLiteral("/levels.log"));
+
+      if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+         content = QString::fromUtf8(file.readAll());
+   } while (!content.contains(QStringLiteral("Levels message, last one")) && !deadline.hasExpired());
+
+   const auto hasDebug = content.contains(QStringLiteral("from the Debug module"));
+   const auto hasFiltered = content.contains(QStringLiteral("from the Warning module"));
+
+   qInfo().noquote() << QString("Shared file levels: Debug module %1, Warning module filtered %2, conflict refused %3")
+                            .arg(hasDebug)
+                            .arg(!hasFiltered)
+                            .arg(isConflictRefused);
+
+   return hasDebug && !hasFiltered && isConflictRefused;
+}
+
+/**
+ * @brief Sets a retention policy that keeps no rotated file on a folder with a log file from a previous run, and then
+ * adds a destination that appends to that file. The scan finds the file before the destination is added, but it is
+ * active now, so only the old rotated file is deleted.
+ * @return True if the rotated file is deleted and the active file is kept.
+ */
+bool retentionActiveFile()
+{
+   const auto manager = QLoggerManager::getInstance();
+   const auto folder = QDir::tempPath() + QStringLiteral("/QLoggerBenchmarkRetention");
+   const auto activePath = folder + QStringLiteral("/retained.log");
+   const auto rotatedPath = folder + QStringLiteral("/retained_2.log");
+
+   QDir(folder).removeRecursively();
+   QDir().mkpath(folder);
+
+   for (const auto &path : { rotatedPath, activePath })
+   {
+      QFile file(path);
+
+      if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+         file.write("Line from the previous run\n");
+   }
+
+   manager->setRetentionPolicy(folder, { -1, -1, 0 });
+   manager->addDestination(QStringLiteral("retained.log"), QStringLiteral("QLoggerBenchmark.retention"),
+                           LogLevel::Info, folder, LogMode::OnlyFile, LogFileDisplay::Number,
+                           LogMessageDisplay::Default, false);
+
+   const QDeadlineTimer deadline(5000);
+
+   while (QFile::exists(rotatedPath) && !deadline.hasExpired())
+      QThread::msleep(10);
+
+   // The retention thread could still be deleting files
+   QThread::msleep(100);
+
+   const auto isRotatedDeleted = !QFile::exists(rotatedPath);
+   const auto isActiveKept = QFile::exists(activePath);
+
+   qInfo().noquote() << QString("Retention of the active file: rotated file deleted %1, active file kept %2")
+                            .arg(isRotatedDeleted)
+                            .arg(isActiveKept);
+
+   return isRotatedDeleted && isActiveKept;
+}
+
+/**
+ * @brief Logs Trace messages below the threshold to a module with a flight recorder and to a module without it, and
+ * then an Error to the first one. The recorder enables the Trace call sites, so both modules evaluate their messages,
+ * but only the recorded one keeps them. Its context has to be written before the Error even though the Error goes
+ * to the priority lane.
+ * @return True if the context precedes the Error and the other module doesn't write its messages.
+ */
+bool flightRecorderContext()
+{
+   static const int kContext = 8;
+
+   const auto manager = QLoggerManager::getInstance();
+   const auto folder = QDir::tempPath() + QStringLiteral("/QLoggerBenchmarkRecorder");
+   const auto recorded = QStringLiteral("QLoggerBenchmark.recorded");
+   const auto other = QStringLiteral("QLoggerBenchmark.other");
+
+   QDir(folder).removeRecursively();
+
+   // The sequence number lets the Error skip the queue
+   manager->addDestination(QStringLiteral("recorded.log"), recorded, LogLevel::Info, folder, LogMode::OnlyFile,
+                           LogFileDisplay::Number, LogMessageDisplay::Default | LogMessageDisplay::Sequence, false);
+   manager->addDestination(QStringLiteral("other.log"), other, LogLevel::Info, folder, LogMode::OnlyFile,
+                           LogFileDisplay::Number, LogMessageDisplay::Default, false);
+   manager->enableFlightRecorder(recorded, kContext);
+
+   auto evaluated = 0;
+   const auto message = [&evaluated](int i) {
+      ++evaluated;
+      return QStringLiteral("Recorder context %1").arg(i);
+   };
+
+   for (auto i = 0; i < kContext; ++i)
+   {
+      QLog_Trace(recorded, message(i));
+      QLog_Trace(other, message(i));
+   }
+
+   QLog_Error(recorded, QStringLiteral("Recorder failure"));
+
+   QStringList lines;
+   const QDeadlineTimer deadline(5000);
+
+   do
+   {
+      QThread::msleep(10);
+      lines.clear();
+
+      QFile file(folder + QStringLiteral("/recorded.log"));
+
+      if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+      {
+         while (!file.atEnd())
+            lines.append(QString::fromUtf8(file.readLine()));
+      }
+   } while (lines.count() < kContext + 1 && !deadline.hasExpired());
+
+   manager->disableFlightRecorder(recorded);
+
+   QFile otherFile(folder + QStringLiteral("/other.log"));
+   const auto isOtherSkipped = !otherFile.exists() || (otherFile.open(QIODevice::ReadOnly) && otherFile.size() == 0);
+
+   auto isOrdered = lines.count() == kContext + 1;
+
+   for (auto i = 0; isOrdered && i < kContext; ++i)
+      isOrdered = lines.at(i).contains(QStringLiteral("Recorder context %1").arg(i));
+
+   isOrdered = isOrdered && lines.constLast().contains(QStringLiteral("Recorder failure"));
+
+   // Without the sequence number the Error would not use the priority lane at all
+   const auto isSequenced = !lines.isEmpty() && lines.constLast().contains(QStringLiteral("[#"));
+
+   qInfo().noquote() << QString("Flight recorder: %1 lines, context %2, %3 messages evaluated, sequence %4, other "
+                                "module %5")
+                            .arg(lines.count())
+                            .arg(isOrdered ? "before the error" : "out of order")
+                            .arg(evaluated)
+                            .arg(isSequenced ? "written" : "missing")
+                            .arg(isOtherSkipped ? "skipped" : "written");
+
+   return isOrdered && isSequenced && isOtherSkipped && evaluated == 2 * kContext;
+}
+
+/**
+ * @brief Measures the throughput of a socket destination against a local receiver, first while the receiver reads
+ * and then while it stalls for half a second. Messages may be dropped while the receiver stalls, but every message
+ * has to be either received or reported as dropped.
+ * @return True if no message is lost without being reported.
+ */
+bool socketDestination()
+{
+#if defined(Q_OS_UNIX)
+   static const int kMessages = 200000;
+
+   const auto path = QDir::tempPath() + QStringLiteral("/QLoggerBenchmark.sock");
+   SocketReceiver receiver(path);
+
+   if (!receiver.start())
+   {
+      qInfo() << "Socket destination: cannot create the receiver socket";
+      return false;
+   }
+
+   QLoggerSocketWriter writer(QStringLiteral("unix:") + path, LogLevel::Trace, LogSocketFraming::LengthPrefixed);
+   writer.setMaxBufferedBytes(1024 * 1024);
+   writer.start();
+
+   const auto text = QStringLiteral("[Info][QLoggerBenchmark][1700000000][0x1] Socket message of a typical size");
+
+   const auto measure = [&](const QString &name, bool stall) {
+      const auto receivedBefore = receiver.receivedCount();
+      const auto droppedBefore = writer.getDroppedCount();
+
+      receiver.setStalled(stall);
+
+      QElapsedTimer timer;
+      timer.start();
+
+      for (auto i = 0; i < kMessages; ++i)
+         writer.enqueue(text, LogLevel::Info);
+
+      const auto producerMs = timer.elapsed();
+
+      if (stall)
+      {
+         QThread::msleep(500);
+         receiver.setStalled(false);
+      }
+
+      // Every message ends up either received or dropped
+      const QDeadlineTimer deadline(10000);
+      quint64 received = 0;
+      quint64 dropped = 0;
+
+      do
+      {
+         QThread::msleep(1);
+         received = receiver.receivedCount() - receivedBefore;
+         dropped = writer.getDroppedCount() - droppedBefore;
+      } while (received + dropped < kMessages && !deadline.hasExpired());
+
+      const auto elapsedMs = qMax<qint64>(timer.elapsed(), 1);
+
+      qInfo().noquote() << QString("Socket destination (%1): %2 msg/s, producer %3 ms, %4 received, %5 dropped")
+                               .arg(name)
+                               .arg(kMessages * 1000 / elapsedMs)
+                               .arg(producerMs)
+                               .arg(received)
+                               .arg(dropped);
+
+      return received + dropped == kMessages;
+   };
+
+   const auto flowing = measure(QStringLiteral("receiver reading"), false);
+   const auto stalled = measure(QStringLiteral("receiver stalled"), true);
+
+   writer.closeDestination();
+   writer.wait();
+   receiver.stop();
+
+   return flowing && stalled;
+#else
+   return true;
+#endif
+}
+}
+
+int main(int argc, char *argv[])
+{
+   QCoreApplication a(argc, argv);
+
+   qInfo() << "--- QLoggerBenchmark ---";
+
+   const auto manager = QLoggerManager::getInstance();
+
+   // Every module gets its destination before logging, so the call sites below its level can be disabled
+   manager->setQueueUnroutedMessages(false);
+   manager->addDestination(QStringLiteral("benchmark.log"), kModule, LogLevel::Debug,
+                           QDir::tempPath() + QStringLiteral("/QLoggerBenchmark"), LogMode::OnlyFile,
+                           LogFileDisplay::DateTime, LogMessageDisplay::Default, false);
+   manager->overwriteMaxFileSize(64 * 1024 * 1024);
+
+   auto success = true;
+
+   success &= allocationsPerLogCall();
+   success &= streamingBuilder();
+   success &= memoryBudget();
+   success &= batchDelay();
+   success &= destinationStartup();
+   success &= scopeTiming();
+   success &= pauseBuffer();
+   success &= socketDestination();
+   success &= sharedFileRotation();
+   success &= sharedFileLevels();
+   success &= retentionActiveFile();
+   success &= sharedRingStall();
+   success &= flightRecorderContext();
+
+   qInfo() << (success ? "# Passed." : "# Failed.");
+
+   return success ? 0 : 1;
+}
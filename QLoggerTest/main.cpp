@@ -47,10 +47,14 @@ int main(int argc, char *argv[])
    QLog_Debug(l_module1, QStringLiteral("This is a debug log message 2..."));
    QLog_Debug(l_module1, QStringLiteral("This is a debug log message 3...."));
 
-   // Try to create another module of the same name but with a different file name and level - ignoring
-   l_manager->addDestination(l_file2, l_module1, LogLevel::Debug);
+   // Try to create the same destination again - ignoring
+   l_manager->addDestination(l_file1, l_module1, LogLevel::Debug);
+   // Add a second destination for the same module, only for warnings and above
+   l_manager->addDestination(l_file2, l_module1, LogLevel::Warning);
    // The log message is written into the file1
    QLog_Debug(l_module1, QStringLiteral("This is a debug log message 0."));
+   // The log message is written into the file1 and the file2
+   QLog_Warning(l_module1, QStringLiteral("This is a warning log message 0."));
 
    // The module doesn't exist yet - messages are enqueued
    QLog_Debug(l_module2, QStringLiteral("This is a TestiiTest."));
@@ -80,6 +84,50 @@ int main(int argc, char *argv[])
                              LogMessageDisplay::DateTime | LogMessageDisplay::Message);
    QLog_Debug(l_module4, QStringLiteral("This is a TestiiTest two.."));
 
+   // Hierarchical modules - every module under "QLoggerTest.net" goes to the same destination
+   l_manager->addDestination(QStringLiteral("net.log"), QStringLiteral("QLoggerTest.net.*"), LogLevel::Debug);
+   QLog_Debug(QStringLiteral("QLoggerTest.net.http"), QStringLiteral("This is a hierarchical module."));
+   QLog_Debug(QStringLiteral("QLoggerTest.net.tcp.client"), QStringLiteral("This is a nested hierarchical module."));
+
+   // Qt messages routed through QLogger - the default category goes to the "QLoggerTest.qt" module
+   l_manager->addDestination(QStringLiteral("qt.log"), QStringLiteral("QLoggerTest.qt"), LogLevel::Debug);
+   l_manager->installQtMessageHandler(QStringLiteral("QLoggerTest.qt"));
+   qDebug() << "This is a qDebug message written by QLogger.";
+   qWarning() << "This is a qWarning message written by QLogger.";
+   l_manager->uninstallQtMessageHandler();
+
+   // Sampled logging from a hot loop - only 1 out of 100 messages is written
+   for (auto i = 0; i < 1000; ++i)
+      QLog_EveryN(l_module3, LogLevel::Debug, 100, QString("Sampled debug log message %1").arg(i));
+
+   // Flight recorder - the debug messages are only written when an error happens
+   l_manager->addDestination(QStringLiteral("recorder.log"), QStringLiteral("QLoggerTest.recorder"), LogLevel::Debug);
+   l_manager->enableFlightRecorder(QStringLiteral("QLoggerTest.recorder"), 16);
+   for (auto i = 0; i < 100; ++i)
+      QLog_Debug(QStringLiteral("QLoggerTest.recorder"), QString("Recorded debug log message %1").arg(i));
+   QLog_Error(QStringLiteral("QLoggerTest.recorder"), QStringLiteral("This error writes the last 16 debug messages."));
+
+   // Streamed message - nothing is built if the level is disabled for the module
+   QLog_DebugS(l_module3) << "Streamed debug log message " << 42 << " took " << 1.5 << "ms";
+
+   // Scoped timing - the durations are summarized in the module instead of one line per measure
+   for (auto i = 0; i < 1000; ++i)
+   {
+      QLog_Scope(l_module3, QStringLiteral("sampled loop"));
+      QLog_EveryN(l_module3, LogLevel::Debug, 1000, QString("Timed debug log message %1").arg(i));
+   }
+   l_manager->reportScopes();
+
+   // Log volume - the call sites that have logged the most so far
+   l_manager->reportVolume(l_module3, 5);
+
+   // Structured logging - one JSON object per line with the fields as typed values
+   l_manager->addDestination(QStringLiteral("structured.jsonl"), QStringLiteral("QLoggerTest.structured"),
+                             LogLevel::Info, QString(), LogMode::OnlyFile, LogFileDisplay::DateTime,
+                             LogMessageDisplay::Json);
+   QLog_Structured(QStringLiteral("QLoggerTest.structured"), LogLevel::Info, QStringLiteral("Request done"),
+                   { "user", QStringLiteral("alice") }, { "status", 200 }, { "elapsed", 12.5 }, { "cached", false });
+
    QTimer::singleShot(2500, &a, []() {
       qInfo() << "# Done.";
       exit(0);
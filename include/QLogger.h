@@ -22,15 +22,85 @@
  ***************************************************************************************/
 
 #include <QLoggerTypes.h>
-
+#include <QLoggerCallSite.h>
+#include <QLoggerField.h>
+#include <QLoggerSampling.h>
+#include <QLoggerScope.h>
+#include <QLoggerStream.h>
+
+#include <QDeadlineTimer>
+#include <QHash>
 #include <QMutex>
 #include <QMap>
+#include <QStringList>
 #include <QVariant>
+#include <QtGlobal>
+
+#include <memory>
 
 namespace QLogger
 {
 
 class QLoggerWriter;
+class QLoggerRoutingTable;
+class QLoggerRetention;
+class QLoggerFlightRecorder;
+class QLoggerPauseBuffer;
+class QLoggerScopeReporter;
+class QLoggerVolumeReporter;
+class QLoggerSharedRing;
+struct QLoggerRecord;
+
+/**
+ * @brief The ShutdownReport struct describes what could not be done before the shutdown deadline.
+ */
+struct ShutdownReport
+{
+   /**
+    * @brief Destinations whose writer didn't finish writing its messages before the deadline.
+    */
+   QStringList pendingDestinations;
+
+   /**
+    * @brief Log files that couldn't be moved to the folder set with moveLogsWhenClose.
+    */
+   QStringList notMovedFiles;
+
+   bool isComplete() const { return pendingDestinations.isEmpty() && notMovedFiles.isEmpty(); }
+};
+
+/**
+ * @brief The MemoryStatistics struct describes the memory used by the queued messages of all the destinations.
+ */
+struct MemoryStatistics
+{
+   qint64 limit = 0; //! @note 0 if there is no budget
+   qint64 used = 0;
+   qint64 highWater = 0;
+   quint64 dropped = 0; //! @note Messages dropped because their level had no room left in the budget
+};
+
+/**
+ * @brief The PauseStatistics struct describes the messages kept while the QLoggerManager is paused.
+ */
+struct PauseStatistics
+{
+   quint64 buffered = 0; //! @note Messages waiting to be written, in memory or in the spill file
+   quint64 spilled = 0; //! @note The part of the buffered messages that is in the spill file
+   quint64 dropped = 0; //! @note Messages lost because the buffer was full
+   qint64 memoryUsed = 0;
+   qint64 spillUsed = 0;
+};
+
+/**
+ * @brief The QLoggerDestination struct is a writer assigned to a module pattern and the lowest level that the module
+ * sends to it. The modules that share the writer of a file can do it with different levels.
+ */
+struct QLoggerDestination
+{
+   QLoggerWriter *writer = nullptr;
+   LogLevel level = LogLevel::Trace;
+};
 
 /**
  * @brief The QLoggerManager class manages the different destination files that we would like to have.
@@ -47,11 +117,18 @@ public:
    /**
     * @brief This method creates a QLoogerWriter that stores the name of the file and the log
     * level assigned to it. Here is added to the map the different modules assigned to each
-    * log file. The method returns <em>false</em> if a module is configured to be stored in
-    * more than one file.
+    * log file. A module can be sent to several destinations, each one with its own level and
+    * message options. The method returns <em>false</em> if the module is already configured to
+    * be stored in the same file.
+    *
+    * All the modules stored in the same file share its writer, since the writer keeps the file open and rotates it.
+    * The level, mode and options of the first destination added for the file apply to all of them.
+    *
+    * Modules are dotted hierarchical names. The module can be an exact name ("net.http.client"), all the
+    * descendants of a module ("net.*") or all the modules ("*"). The most specific destination wins.
     *
     * @param fileDest The file name and path to print logs.
-    * @param module The module that will be stored in the file.
+    * @param module The module or module pattern that will be stored in the file.
     * @param level The maximum level allowed.
     * @param fileFolderDestination The complete folder destination.
     * @param mode The logging mode.
@@ -66,8 +143,9 @@ public:
    /**
     * @brief This method creates a QLoogerWriter that stores the name of the file and the log
     * level assigned to it. Here is added to the map the different modules assigned to each
-    * log file. The method returns <em>false</em> if a module is configured to be stored in
-    * more than one file.
+    * log file. A module can be sent to several destinations, each one with its own level and
+    * message options. The method returns <em>false</em> if the module is already configured to
+    * be stored in the same file. All the modules share the writer of the file.
     *
     * @param fileDest The file name and path to print logs.
     * @param modules The modules that will be stored in the file.
@@ -86,23 +164,114 @@ public:
    /**
     * @brief addListener Injects a listener that will be notified for each message that fulfills all the filters.
     * @param callback The callback where each new message will be sent.
-    * @param level Filters the level of the received messages.
+    * @param level Filters the level of the received messages. The listener is notified once per message, even if the
+    * module has several destinations.
     * @return Returns the ID to unsbuscribe from the calls.
     */
    uint64_t addListener(ListenerCallback callback, LogLevel level = LogLevel::Debug);
 
    void removeListener(uint64_t id);
 
+   /**
+    * @brief installQtMessageHandler Routes the messages printed with qDebug, qInfo, qWarning, qCritical and qFatal
+    * through QLogger. The message type is mapped to the log level (qCritical is Error) and the logging category is
+    * used as module, so categories like "qt.network.ssl" work with hierarchical destinations.
+    *
+    * Messages printed by QLogger itself (console mode, listeners) are forwarded to the previous handler, so they
+    * never loop back.
+    *
+    * @param defaultModule The module used for the messages of the default category.
+    */
+   void installQtMessageHandler(const QString &defaultModule = QStringLiteral("qt"));
+
+   /**
+    * @brief uninstallQtMessageHandler Restores the message handler that was installed before
+    * installQtMessageHandler.
+    */
+   void uninstallQtMessageHandler();
+
+   /**
+    * @brief addSocketDestination Sends the messages of the module to a local socket instead of a file. The writer
+    * thread sends every batch with one non-blocking call. While the receiver is stalled or not available, the
+    * batches are buffered up to a limit and then the oldest ones are dropped; the connection is retried every second.
+    *
+    * @param address "unix:<path>" for a Unix domain stream socket or "udp:<host>:<port>" for a local UDP socket.
+    * @param module The module or module pattern that will be sent.
+    * @param level The maximum level allowed.
+    * @param framing The framing of the messages: length prefixed or syslog (RFC 5424).
+    * @param messageOptions Specifies what elements are displayed in one line of log message.
+    * @return False if the address is not valid or the module is already sent to it.
+    */
+   bool addSocketDestination(const QString &address, const QString &module, LogLevel level = LogLevel::Warning,
+                             LogSocketFraming framing = LogSocketFraming::LengthPrefixed,
+                             LogMessageDisplays messageOptions = LogMessageDisplay::Default);
+
+   /**
+    * @brief enableFlightRecorder Keeps the Trace and Debug messages of the module in an in-memory ring instead of
+    * writing them. The ring is written to the destinations of the module right before any Error or Fatal message of
+    * the module, or when dumpFlightRecorder is called, so the context of a failure is available without writing all
+    * the debug messages to disk.
+    *
+    * @param module The module. It has to match exactly the module of the messages.
+    * @param capacity The amount of messages kept. Once full, the oldest message is replaced.
+    */
+   void enableFlightRecorder(const QString &module, int capacity = 1024);
+
+   /**
+    * @brief disableFlightRecorder Removes the flight recorder of the module. The messages in the ring are discarded.
+    *
+    * @param module The module.
+    */
+   void disableFlightRecorder(const QString &module);
+
+   /**
+    * @brief dumpFlightRecorder Writes the messages in the flight recorder to the destinations of the module and
+    * empties the ring.
+    *
+    * @param module The module. If empty, the flight recorders of all the modules are written.
+    */
+   void dumpFlightRecorder(const QString &module = QString());
+
+   /**
+    * @brief enableSharedMemoryMode Sends the messages of all the modules to the shared memory ring of a collector
+    * process (see tools/qlogger-collector) instead of the local destinations. The collector writes the messages of
+    * all the processes in a single ordered file, so the processes don't pay the file and rotation costs. The default
+    * level is used to filter the messages. If the ring is full, the messages are dropped instead of blocking.
+    *
+    * @param key The key of the shared memory given to the collector.
+    * @return True if the ring of the collector was found, otherwise false and the local destinations are used.
+    */
+   bool enableSharedMemoryMode(const QString &key);
+
+   /**
+    * @brief disableSharedMemoryMode Detaches from the collector and goes back to the local destinations.
+    */
+   void disableSharedMemoryMode();
+
    /**
     * @brief Clears old log files from the current storage folder.
     *
+    * @note Prefer setRetentionPolicy, that cleans the folder in the background without scanning it every time.
+    *
     * @param fileFolderDestination The destination folder.
     * @param days Minimum age of log files to delete. Logs older than
     *        this value will be removed. If days is -1, deletes any log file.
     */
    static void clearFileDestinationFolder(const QString &fileFolderDestination, int days = -1);
+
    /**
-    * @brief enqueueMessage Enqueues a message in the corresponding QLoggerWritter.
+    * @brief setRetentionPolicy Starts a background service that deletes the oldest rotated log files of the folder
+    * when they exceed the maximum age, total size or count of the policy. The folder is scanned once and then the
+    * rotations are tracked in memory. The files being written are never deleted.
+    *
+    * @param fileFolderDestination The destination folder. If empty, the default destination folder.
+    * @param policy The limits to apply. Calling it again for the same folder replaces the policy.
+    */
+   void setRetentionPolicy(const QString &fileFolderDestination, const RetentionPolicy &policy);
+   /**
+    * @brief enqueueMessage Enqueues a message in the corresponding QLoggerWritter. If the file is given, the message
+    * gets the call site that the registry keeps for its location, so it can be enabled or disabled like the sites of
+    * the QLog_* macros.
     * @param module The module that writes the message.
     * @param level The level of the message.
     * @param message The message to log.
@@ -113,21 +282,69 @@ public:
    void enqueueMessage(const QString &module, LogLevel level, const QString &message, const QString &function,
                        const QString &file, int line);
 
+   /**
+    * @brief enqueueMessage Enqueues a message coming from a registered call site. If the call site has been
+    * explicitly enabled, the message bypasses the level of the destination.
+    * @param site The call site where the log comes from.
+    * @param module The module that writes the message.
+    * @param message The message to log.
+    */
+   void enqueueMessage(const CallSite &site, const QString &module, const QString &message);
+
+   /**
+    * @brief enqueueMessage Enqueues a message with typed key/value fields coming from a registered call site. The
+    * fields are written by the destinations with their own layout (see LogMessageDisplay::Json).
+    * @param site The call site where the log comes from.
+    * @param module The module that writes the message.
+    * @param message The message to log.
+    * @param fields The fields of the message.
+    */
+   void enqueueMessage(const CallSite &site, const QString &module, const QString &message,
+                       std::initializer_list<Field> fields);
+
+   /**
+    * @brief isLevelEnabled Checks if a message of the module and level would be kept, so a message that is expensive
+    * to build can be skipped. It is more precise than the call site, that only knows the lowest level of all the
+    * destinations.
+    * @param module The module that writes the message.
+    * @param level The level of the message.
+    * @return True if the message reaches a destination, a flight recorder or the queue of the modules without
+    * destination.
+    */
+   bool isLevelEnabled(const QString &module, LogLevel level) const;
+
    /**
     * @brief Whether the QLogger is paused or not.
     */
    bool isPaused() const { return mIsStop; }
 
    /**
-    * @brief pause Pauses all QLoggerWriters.
+    * @brief pause Pauses all QLoggerWriters. Unless a pause buffer has been set with setPauseBuffer, the messages
+    * logged while paused are discarded.
     */
    void pause();
 
    /**
-    * @brief resume Resumes all QLoggerWriters that where paused.
+    * @brief resume Resumes all QLoggerWriters that where paused. The messages kept in the pause buffer are written
+    * first, in batches from a pooled thread, and the messages logged meanwhile are kept after them, so the order
+    * doesn't change, resume returns at once and the callers are never blocked for more than one batch.
     */
    void resume();
 
+   /**
+    * @brief setPauseBuffer Keeps the messages logged while paused instead of discarding them. They are stored raw in
+    * memory and, once the memory is full, serialized to a temporary file. When both are full the new messages are
+    * dropped.
+    * @param memoryBytes The memory for the paused messages. If 0, and spillBytes is 0, the messages are discarded.
+    * @param spillBytes The maximum size of the temporary file. If 0, nothing is written to disk.
+    */
+   void setPauseBuffer(qint64 memoryBytes, qint64 spillBytes = 0);
+
+   /**
+    * @brief getPauseStatistics Gets the messages kept in the pause buffer and the ones it had to drop.
+    */
+   PauseStatistics getPauseStatistics() const;
+
    /**
     * @brief getDefaultFileDestinationFolder Gets the default file destination folder.
     * @return The file destination folder
@@ -152,9 +369,23 @@ public:
    void setDefaultFileDestinationFolder(const QString &fileDestinationFolder);
    void setDefaultFileDestination(const QString &fileDestination) { mDefaultFileDestination = fileDestination; }
    void setDefaultFileSuffixIfFull(LogFileDisplay fileSuffixIfFull) { mDefaultFileSuffixIfFull = fileSuffixIfFull; }
-   void setDefaultLevel(LogLevel level) { mDefaultLevel = level; }
+   void setDefaultLevel(LogLevel level);
+
+   /**
+    * @brief setQueueUnroutedMessages Sets whether the messages of the modules without destination are kept until a
+    * destination is added for them, which is the default. While they are kept, the call sites can't be disabled by
+    * level unless there is a destination for all the modules ("*"), since any module could still get a destination
+    * that accepts Trace messages. Without the queue, the call sites below the lowest level of all the destinations
+    * only cost one atomic load.
+    * @param queue False to discard the messages of the modules without destination.
+    */
+   void setQueueUnroutedMessages(bool queue);
    void setDefaultMode(LogMode mode) { mDefaultMode = mode; }
    void setDefaultMaxFileSize(int maxFileSize) { mDefaultMaxFileSize = maxFileSize; }
+   void setDefaultMaxRotatedFiles(int maxRotatedFiles) { mDefaultMaxRotatedFiles = maxRotatedFiles; }
+   void setDefaultRotation(LogRotation rotation) { mDefaultRotation = rotation; }
+   void setDefaultIndexBlockSize(int blockSize) { mDefaultIndexBlockSize = blockSize; }
+   void setDefaultBatchDelay(int microseconds) { mDefaultBatchDelay = microseconds; }
    void setDefaultMessageOptions(LogMessageDisplays messageOptions) { mDefaultMessageOptions = messageOptions; }
 
    /**
@@ -173,9 +404,97 @@ public:
     * @brief overwriteMaxFileSize Overwrites the maximum file size in all the destinations. Sets the default max file
     * size.
     *
-    * @param maxSize The new file size
+    * @param maxSize The new file size. If 0, the files are not rotated by size.
     */
    void overwriteMaxFileSize(int maxSize);
+   /**
+    * @brief overwriteMaxRotatedFiles Overwrites the maximum amount of numbered files kept by the destinations that
+    * rotate with LogFileDisplay::Number. Once reached, the oldest file is replaced. Sets the default value.
+    *
+    * @param maxRotatedFiles The new maximum amount. If 0, there is no limit.
+    */
+   void overwriteMaxRotatedFiles(int maxRotatedFiles);
+   /**
+    * @brief overwriteRotation Overwrites the time based rotation in all the destinations. The maximum file size still
+    * applies. Sets the default rotation.
+    *
+    * @param rotation The new rotation
+    */
+   void overwriteRotation(LogRotation rotation);
+   /**
+    * @brief overwriteIndexBlockSize Overwrites the block size of the sidecar index in all the destinations. Sets the
+    * default block size.
+    *
+    * @param blockSize The new block size in bytes. If 0, the index is disabled.
+    */
+   void overwriteIndexBlockSize(int blockSize);
+
+   /**
+    * @brief overwriteBatchDelay Overwrites the time that the writers wait for more messages before writing a batch
+    * in all the destinations. Sets the default batch delay. A longer delay writes larger batches with fewer wake-ups
+    * at the cost of latency; Error and Fatal messages end the wait.
+    *
+    * @param microseconds The new delay in microseconds. If 0, the messages are written as soon as possible.
+    */
+   void overwriteBatchDelay(int microseconds);
+
+   /**
+    * @brief setMaxPooledMessageSize Sets the maximum size in characters of the formatted messages that are stored in
+    * recycled buffers. Logging messages under this size doesn't allocate memory once the logger is warmed up.
+    * @param size The maximum size. The default is 512 characters.
+    */
+   void setMaxPooledMessageSize(int size);
+
+   /**
+    * @brief setMemoryBudget Sets the memory that the queued messages of all the destinations can use together. When
+    * the budget is full, new messages are dropped. An eighth of the budget is reserved for Error and Fatal messages
+    * unless it is changed with setMemoryReservation.
+    * @param bytes The budget in bytes. If 0, the default, there is no limit.
+    */
+   void setMemoryBudget(qint64 bytes);
+
+   /**
+    * @brief setMemoryReservation Reserves part of the memory budget for the messages of the given level and above.
+    * @param level The lowest level that can use the reserved memory.
+    * @param bytes The reserved bytes.
+    */
+   void setMemoryReservation(LogLevel level, qint64 bytes);
+
+   /**
+    * @brief getMemoryStatistics Gets the memory budget, the memory used by the queued messages, its high-water mark
+    * and the amount of messages dropped because of the budget.
+    */
+   MemoryStatistics getMemoryStatistics() const;
+
+   /**
+    * @brief setScopeReportInterval Sets how often the durations measured with QLog_Scope are summarized in the
+    * destination of their module. Every summary contains the count, mean, p50, p99 and max since the previous one.
+    * @param msecs The interval in milliseconds. The default is 10 seconds.
+    */
+   void setScopeReportInterval(int msecs);
+
+   /**
+    * @brief reportScopes Writes the summaries of the durations measured with QLog_Scope now.
+    */
+   void reportScopes();
+
+   /**
+    * @brief setVolumeReport Periodically writes the call sites that have logged the most, by size and then by number
+    * of messages, to the given module. The counters are kept since the start or since
+    * CallSiteRegistry::resetVolume.
+    * @param module The module that receives the report.
+    * @param msecs The interval in milliseconds. If 0 or negative, the periodic report is stopped.
+    * @param count The amount of call sites in every report.
+    */
+   void setVolumeReport(const QString &module, int msecs = 60000, int count = 10);
+
+   /**
+    * @brief reportVolume Writes the call sites that have logged the most to the given module now. Every call site is
+    * one Info message with its rank, file, line, function, messages and characters as fields.
+    * @param module The module that receives the report.
+    * @param count The amount of call sites in the report.
+    */
+   void reportVolume(const QString &module, int count = 10);
 
    /**
     * @brief moveLogsWhenClose Moves all the logs to a new folder. This will happen only on close.
@@ -183,16 +502,52 @@ public:
     */
    void moveLogsWhenClose(const QString &newLogsFolder) { mNewLogsFolder = newLogsFolder; }
 
+   /**
+    * @brief shutdown Closes all the destinations. The Qt message handler is uninstalled first, so the messages
+    * printed afterwards go to the previous handler. All the writers are signaled at once so they drain their messages
+    * concurrently, and then the logs are moved to the folder set with moveLogsWhenClose. The destinations that
+    * don't finish before the deadline are left running and reported. The destructor of the manager waits for them.
+    *
+    * @param timeout The maximum time in milliseconds to wait. If negative, it waits until everything is done.
+    * @return The report of what could not be done before the deadline.
+    */
+   ShutdownReport shutdown(int timeout = 5000);
+
 private:
+   friend class ScopeSite;
+
    /**
     * @brief Checks if the logger is stop
     */
    bool mIsStop = false;
 
    /**
-    * @brief Map that stores the module and the file it is assigned.
+    * @brief Whether the new messages go to the pause buffer. It stays set after resume until the buffer is drained.
+    */
+   bool mIsBuffering = false;
+   bool mIsDraining = false; //! @note A pooled thread is writing the pause buffer
+   QLoggerPauseBuffer *mPauseBuffer = nullptr;
+
+   /**
+    * @brief Process-wide sequence number assigned to every message when it is captured.
     */
-   QMap<QString, QLoggerWriter *> mModuleDest;
+   quint64 mSequence = 0;
+
+   /**
+    * @brief Map that stores the module pattern and the files it is assigned with the level of each one.
+    */
+   QMultiMap<QString, QLoggerDestination> mModuleDest;
+
+   /**
+    * @brief Routing table of the destinations in mModuleDest. It is updated in place when a destination is added and
+    * rebuilt when their levels change, so it is only read and written with mMutex held.
+    */
+   std::unique_ptr<QLoggerRoutingTable> mRoutes;
+
+   /**
+    * @brief The writer of every file, so a module stored in a file that already has a writer shares it.
+    */
+   QHash<QString, QLoggerWriter *> mFileWriters;
 
    /**
     * @brief Defines the queue of messages when no writers have been set yet.
@@ -207,23 +562,72 @@ private:
    LogFileDisplay mDefaultFileSuffixIfFull = LogFileDisplay::DateTime;
    LogMode mDefaultMode = LogMode::OnlyFile;
    LogLevel mDefaultLevel = LogLevel::Warning;
+   bool mQueueUnroutedMessages = true;
    int mDefaultMaxFileSize = 1024 * 1024; //! @note 1Mio
+   int mDefaultMaxRotatedFiles = 0;
+   LogRotation mDefaultRotation = LogRotation::Size;
+   int mDefaultIndexBlockSize = 0;
+   int mDefaultBatchDelay = 0;
    LogMessageDisplays mDefaultMessageOptions = LogMessageDisplay::Default;
    QString mNewLogsFolder;
 
+   struct Listener
+   {
+      LogLevel level;
+      ListenerCallback callback;
+   };
+
+   /**
+    * @brief Retention services by folder. They have their own mutex because the writers notify the rotations from
+    * their threads.
+    */
+   QMutex mRetentionMutex;
+   QMap<QString, QLoggerRetention *> mRetention;
+
+   /**
+    * @brief Writers and retention services that didn't finish before the shutdown deadline. They still use the
+    * buffer pool and the memory budget, so the destructor waits for them before those are destroyed.
+    */
+   QVector<QLoggerWriter *> mPendingWriters;
+   QVector<QLoggerRetention *> mPendingRetention;
+
+   QMap<QString, QLoggerFlightRecorder *> mFlightRecorders;
+
+   QLoggerSharedRing *mSharedRing = nullptr;
+
+   /**
+    * @brief Summarizes the QLog_Scope histograms. It has its own mutex because the scope sites register from any
+    * thread and the reporter enqueues its summaries with mMutex.
+    */
+   QMutex mScopeMutex;
+   QLoggerScopeReporter *mScopeReporter = nullptr;
+   int mScopeReportInterval = 10000;
+
+   //! @note Also guarded by mScopeMutex, since it enqueues its reports with mMutex as well
+   QLoggerVolumeReporter *mVolumeReporter = nullptr;
+
+   /**
+    * @brief Guards the Qt message handler state. It is not mMutex because the handler reads it from any thread, also
+    * from the writer threads that a thread holding mMutex may be waiting for.
+    */
+   QMutex mQtHandlerMutex;
+   QString mQtDefaultModule;
+   QtMessageHandler mPreviousQtHandler = nullptr;
+   bool mQtHandlerInstalled = false;
+
    QRecursiveMutex mCallbacksMutex;
-   QMap<uint64_t, ListenerCallback> mCallbacks;
+   QMap<uint64_t, Listener> mCallbacks;
    uint64_t mListenerId = -1;
 
    /**
     * @brief Mutex to make the method thread-safe.
     */
-   QRecursiveMutex mMutex;
+   mutable QRecursiveMutex mMutex;
 
    /**
     * @brief Default builder of the class. It starts the thread.
     */
-   QLoggerManager() = default;
+   QLoggerManager();
 
    /**
     * @brief Destructor
@@ -242,7 +646,41 @@ private:
     */
    QLoggerWriter *createWriter(const QString &fileDest, LogLevel level, const QString &fileFolderDestination,
                                LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions) const;
-   void startWriter(const QString &module, QLoggerWriter *log, LogMode mode, bool notify);
+   void startWriter(const QString &module, QLoggerWriter *log, bool notify);
+
+   /**
+    * @brief Creates and starts a new destination for the module unless the module is already stored in the same file.
+    * If another module is stored in the same file, its writer is shared.
+    * @return The writer of the destination, or nullptr if it has not been added.
+    */
+   QLoggerWriter *addWriter(const QString &fileDest, const QString &module, LogLevel level,
+                            const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull,
+                            LogMessageDisplays messageOptions, bool notify);
+
+   /**
+    * @brief Sends a record to all the destinations of its module. Each distinct layout is formatted only once and
+    * the resulting text is shared among the destinations that use it.
+    * @param record The record to send.
+    * @param destinations The destinations of the module.
+    * @param force If true, the level of the destinations is not checked.
+    * @param priority If true, the record goes to the priority lane of the destinations whatever its level.
+    */
+   void dispatch(const QLoggerRecord &record, const QVector<QLoggerDestination> &destinations, bool force,
+                 bool priority = false);
+
+   /**
+    * @brief Sends the records of a flight recorder to the priority lane of the destinations, no matter their level,
+    * and empties it.
+    * @param recorder The flight recorder.
+    * @param destinations The destinations of the module.
+    */
+   void writeFlightRecorder(QLoggerFlightRecorder *recorder, const QVector<QLoggerDestination> &destinations);
+
+   /**
+    * @brief Sends the oldest records of the pause buffer to their destinations and stops buffering once it is empty.
+    * @return True if the buffer is empty.
+    */
+   bool drainPauseBuffer();
 
    /**
     * @brief Checks the queue and writes the messages if the writer is the correct one. The queue is emptied
@@ -251,7 +689,71 @@ private:
     */
    void writeAndDequeueMessages(const QString &module);
 
-   void notifyListener(const QString& text);
+   /**
+    * @brief Enqueues the message in the writers of the module.
+    * @param fileName The file name without the path.
+    * @param force If true, the level of the destination is not checked.
+    * @param site The call site that counts the message if it reaches a destination, if any.
+    */
+   void enqueue(const QString &module, LogLevel level, const QString &message, const QString &function,
+                const QString &fileName, int line, bool force, const Fields &fields = Fields(),
+                const CallSite *site = nullptr);
+
+   /**
+    * @brief Updates the call site threshold with the lowest level that any destination accepts.
+    */
+   void updateCallSiteThreshold();
+
+   /**
+    * @brief Tells the call sites whether any module has a flight recorder, so the Trace and Debug messages are
+    * enqueued below the threshold and the ones of the modules without recorder are dropped in enqueue.
+    */
+   void updateRecordedModules();
+
+   /**
+    * @brief Rebuilds the routing table after the levels of the destinations change and flushes the queued messages
+    * of the modules that have a destination now.
+    */
+   void rebuildRoutes();
+
+   /**
+    * @brief Adds a new destination to the routing table without rebuilding it and flushes the queued messages of the
+    * modules that have a destination now.
+    */
+   void addRoute(const QString &module, const QLoggerDestination &destination);
+
+   /**
+    * @brief Gets every writer once, even if it is shared by several modules.
+    */
+   QVector<QLoggerWriter *> uniqueWriters() const;
+
+   void notifyListener(LogLevel level, const QString& text);
+
+   /**
+    * @brief Notifies the retention service of the folder that a file has been rotated.
+    * @param folder The normalized folder of the destination.
+    * @param filePath The rotated file.
+    */
+   void notifyFileRotated(const QString &folder, const QString &filePath);
+
+   /**
+    * @brief Moves the files of the given folders to mNewLogsFolder. Each folder is listed only once.
+    * @param folders The folders of the destinations that have been closed.
+    * @param deadline The time limit to move the files.
+    * @return The files that couldn't be moved.
+    */
+   QStringList moveLogs(const QStringList &folders, const QDeadlineTimer &deadline) const;
+
+   /**
+    * @brief Registers a scope site in the reporter, that is created and started with the first site.
+    */
+   void registerScopeSite(ScopeSite *site);
+   void unregisterScopeSite(ScopeSite *site);
+
+   /**
+    * @brief Message handler installed by installQtMessageHandler.
+    */
+   static void qtMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
 };
 
 /**
@@ -271,15 +773,48 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
 
 }
 
+#ifndef QLog_CallSite_
+/**
+ * @brief Registers a static call site and enqueues the message only if the call site is enabled. The message
+ * expression is not evaluated for disabled call sites.
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ * @param message The message.
+ */
+#   define QLog_CallSite_(module, level, message)                                                                      \
+      do                                                                                                               \
+      {                                                                                                                \
+         static QLogger::CallSite qlogCallSite(__FILE__, __LINE__, __FUNCTION__, level);                               \
+         if (qlogCallSite.isEnabled())                                                                                 \
+            QLogger::QLoggerManager::getInstance()->enqueueMessage(qlogCallSite, module, message);                     \
+      } while (false)
+#endif
+
+#ifndef QLog_Structured
+/**
+ * @brief Logs a message with typed key/value fields. The fields are given as {"key", value} pairs and the message
+ * and the fields are not evaluated if the call site is disabled.
+ * Example: QLog_Structured(module, LogLevel::Info, "Request done", {"user", id}, {"ms", elapsed});
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ * @param message The message.
+ */
+#   define QLog_Structured(module, level, message, ...)                                                                \
+      do                                                                                                               \
+      {                                                                                                                \
+         static QLogger::CallSite qlogCallSite(__FILE__, __LINE__, __FUNCTION__, level);                               \
+         if (qlogCallSite.isEnabled())                                                                                 \
+            QLogger::QLoggerManager::getInstance()->enqueueMessage(qlogCallSite, module, message, { __VA_ARGS__ });    \
+      } while (false)
+#endif
+
 #ifndef QLog_Trace
 /**
  * @brief Used to store Trace level messages.
  * @param module The module that the message references.
  * @param message The message.
  */
-#   define QLog_Trace(module, message)                                                                                 \
-      QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Trace, message, __FUNCTION__,  \
-                                                             __FILE__, __LINE__)
+#   define QLog_Trace(module, message) QLog_CallSite_(module, QLogger::LogLevel::Trace, message)
 #endif
 
 #ifndef QLog_Debug
@@ -288,9 +823,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#   define QLog_Debug(module, message)                                                                                 \
-      QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Debug, message, __FUNCTION__,  \
-                                                             __FILE__, __LINE__)
+#   define QLog_Debug(module, message) QLog_CallSite_(module, QLogger::LogLevel::Debug, message)
 #endif
 
 #ifndef QLog_Info
@@ -299,9 +832,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#   define QLog_Info(module, message)                                                                                  \
-      QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Info, message, __FUNCTION__,   \
-                                                             __FILE__, __LINE__)
+#   define QLog_Info(module, message) QLog_CallSite_(module, QLogger::LogLevel::Info, message)
 #endif
 
 #ifndef QLog_Warning
@@ -310,9 +841,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#   define QLog_Warning(module, message)                                                                               \
-      QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Warning, message,              \
-                                                             __FUNCTION__, __FILE__, __LINE__)
+#   define QLog_Warning(module, message) QLog_CallSite_(module, QLogger::LogLevel::Warning, message)
 #endif
 
 #ifndef QLog_Error
@@ -321,9 +850,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#   define QLog_Error(module, message)                                                                                 \
-      QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Error, message, __FUNCTION__,  \
-                                                             __FILE__, __LINE__)
+#   define QLog_Error(module, message) QLog_CallSite_(module, QLogger::LogLevel::Error, message)
 #endif
 
 #ifndef QLog_Fatal
@@ -332,7 +859,5 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#   define QLog_Fatal(module, message)                                                                                 \
-      QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Fatal, message, __FUNCTION__,  \
-                                                             __FILE__, __LINE__)
+#   define QLog_Fatal(module, message) QLog_CallSite_(module, QLogger::LogLevel::Fatal, message)
 #endif
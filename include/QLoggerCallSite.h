@@ -0,0 +1,271 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerTypes.h>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+namespace QLogger
+{
+
+/**
+ * @brief The CallSite class describes one expansion of a QLog_* macro. Every expansion owns a static instance that
+ * registers itself in the CallSiteRegistry the first time it is executed. The registry precomputes whether the site
+ * is enabled, so a disabled site only costs one relaxed atomic load. Every site also counts the messages it sends to
+ * a destination and their length, so the noisiest call sites can be found with CallSiteRegistry::topSites.
+ */
+class CallSite
+{
+public:
+   /**
+    * @brief The Override enum class defines the runtime state forced on a call site.
+    */
+   enum class Override
+   {
+      Inherit = 0,
+      Enabled,
+      Disabled
+   };
+
+   /**
+    * @brief Constructor that registers the call site.
+    * @param file The file where the log comes from.
+    * @param line The line in the file where the log comes from.
+    * @param function The function in the file where the log comes from.
+    * @param level The level of the messages logged from this call site.
+    */
+   CallSite(const char *file, int line, const char *function, LogLevel level);
+
+   /**
+    * @brief Destructor that unregisters the call site.
+    */
+   ~CallSite();
+
+   CallSite(const CallSite &) = delete;
+   CallSite &operator=(const CallSite &) = delete;
+
+   /**
+    * @brief isEnabled Checks if the messages from this call site have to be enqueued. While any module has a flight
+    * recorder, the Trace and Debug call sites below the threshold are enabled too, unless they have been explicitly
+    * disabled, and the QLoggerManager drops the messages of the modules without recorder.
+    */
+   bool isEnabled() const noexcept { return mEnabled.load(std::memory_order_relaxed); }
+
+   /**
+    * @brief isForced Checks if the call site has been explicitly enabled. Forced call sites bypass the level of the
+    * destination.
+    */
+   bool isForced() const noexcept { return mOverride.load(std::memory_order_relaxed) == Override::Enabled; }
+
+   const char *file() const noexcept { return mFile; }
+   int line() const noexcept { return mLine; }
+   const char *function() const noexcept { return mFunction; }
+   LogLevel level() const noexcept { return mLevel; }
+
+   /**
+    * @brief fileName Gets the file name without the path, converted once when the call site is registered.
+    */
+   const QString &fileName() const noexcept { return mFileName; }
+
+   /**
+    * @brief functionName Gets the function name, converted once when the call site is registered.
+    */
+   const QString &functionName() const noexcept { return mFunctionName; }
+
+   /**
+    * @brief countMessage Adds a message to the volume of the call site. It only uses relaxed atomic additions, so it
+    * doesn't lock nor need the message to be formatted.
+    * @param characters The length of the message text in UTF-16 code units.
+    */
+   void countMessage(qint64 characters) const noexcept
+   {
+      mMessages.fetch_add(1, std::memory_order_relaxed);
+      mCharacters.fetch_add(static_cast<quint64>(characters), std::memory_order_relaxed);
+   }
+
+   quint64 messages() const noexcept { return mMessages.load(std::memory_order_relaxed); }
+   quint64 characters() const noexcept { return mCharacters.load(std::memory_order_relaxed); }
+
+private:
+   friend class CallSiteRegistry;
+
+   /**
+    * @brief Tag of the constructor used by the registry for the call sites it owns, which are not registered again.
+    */
+   struct Owned
+   {
+   };
+
+   CallSite(const char *file, int line, const char *function, LogLevel level, Owned);
+
+   const char *mFile;
+   const int mLine;
+   const char *mFunction;
+   const LogLevel mLevel;
+   QString mFileName;
+   QString mFunctionName;
+   std::atomic<bool> mEnabled { true };
+   std::atomic<Override> mOverride { Override::Inherit };
+   mutable std::atomic<quint64> mMessages { 0 };
+   mutable std::atomic<quint64> mCharacters { 0 };
+   bool mIsRegistered = false;
+};
+
+/**
+ * @brief The CallSiteInfo struct is a snapshot of a registered call site.
+ */
+struct CallSiteInfo
+{
+   QString file;
+   int line = -1;
+   QString function;
+   LogLevel level = LogLevel::Trace;
+   bool enabled = true;
+   quint64 messages = 0; //! @note Messages sent to a destination since the start or the last resetVolume
+   quint64 characters = 0; //! @note UTF-16 length of the text of those messages, before the layout adds its fields
+};
+
+/**
+ * @brief The CallSiteRegistry class stores all the call sites that have been executed and allows to enable or disable
+ * them at runtime by file glob and line. Rules are kept so they also apply to call sites that register later.
+ */
+class CallSiteRegistry
+{
+public:
+   /**
+    * @brief Gets an instance to the CallSiteRegistry.
+    * @return A pointer to the instance.
+    */
+   static CallSiteRegistry *getInstance();
+
+   /**
+    * @brief enable Enables the call sites whose file matches the glob, no matter the destination level.
+    * @param fileGlob Wildcard expression matched against the file path or the file name. The * and ? wildcards also
+    * match '/'.
+    * @param line The line to match. If -1, all the lines in the file match.
+    * @return The number of registered call sites affected.
+    */
+   int enable(const QString &fileGlob, int line = -1);
+
+   /**
+    * @brief disable Disables the call sites whose file matches the glob.
+    * @param fileGlob Wildcard expression matched against the file path or the file name. The * and ? wildcards also
+    * match '/'.
+    * @param line The line to match. If -1, all the lines in the file match.
+    * @return The number of registered call sites affected.
+    */
+   int disable(const QString &fileGlob, int line = -1);
+
+   /**
+    * @brief reset Removes all the rules and restores the default state of all the call sites.
+    */
+   void reset();
+
+   /**
+    * @brief setThreshold Sets the minimum level that call sites without override need to be enabled. It is kept
+    * updated by the QLoggerManager with the lowest level configured in any destination.
+    * @param level The new level threshold.
+    */
+   void setThreshold(LogLevel level);
+
+   /**
+    * @brief callSites Gets a snapshot of all the registered call sites.
+    */
+   QVector<CallSiteInfo> callSites() const;
+
+   /**
+    * @brief topSites Gets the call sites that have logged the most, sorted by the length of their messages and then
+    * by their number of messages.
+    * @param count The maximum amount of call sites returned.
+    */
+   QVector<CallSiteInfo> topSites(int count) const;
+
+   /**
+    * @brief resetVolume Sets the message and character counters of all the call sites to 0.
+    */
+   void resetVolume();
+
+   /**
+    * @brief siteFor Gets the call site of a message that is not logged through a QLog_* macro, such as the ones
+    * routed from the Qt message handler, so its volume is counted and its rules apply too. The site is created and
+    * registered the first time and it is owned by the registry. Every thread caches the sites it has looked up, so
+    * the registry is only locked the first time a thread logs from a location.
+    * @param file The file where the log comes from.
+    * @param line The line in the file where the log comes from.
+    * @param function The function in the file where the log comes from.
+    * @param level The level of the message.
+    */
+   const CallSite *siteFor(const QString &file, int line, const QString &function, LogLevel level);
+
+   /**
+    * @brief setRecording Sets whether any module has a flight recorder, which enables the Trace and Debug call sites.
+    * It is kept updated by the QLoggerManager.
+    * @param isRecording True if at least one module has a flight recorder.
+    */
+   void setRecording(bool isRecording);
+
+private:
+   friend class CallSite;
+
+   struct Rule
+   {
+      QRegularExpression fileRegExp;
+      int line = -1;
+      CallSite::Override state = CallSite::Override::Inherit;
+   };
+
+   /**
+    * @brief A call site created by siteFor and the strings it points to.
+    */
+   struct OwnedSite
+   {
+      QByteArray file;
+      QByteArray function;
+      CallSite *site = nullptr;
+   };
+
+   mutable QMutex mMutex;
+   QVector<CallSite *> mSites;
+   QVector<Rule> mRules;
+   LogLevel mThreshold = LogLevel::Trace;
+   bool mIsRecording = false;
+   QHash<QString, OwnedSite> mOwnedSites;
+
+   CallSiteRegistry() = default;
+   ~CallSiteRegistry();
+
+   void registerSite(CallSite *site);
+   void unregisterSite(CallSite *site);
+   int addRule(const QString &fileGlob, int line, CallSite::Override state);
+   static bool matches(const Rule &rule, const CallSite *site);
+   void applyRules(CallSite *site) const;
+};
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+#include <QVarLengthArray>
+
+#include <type_traits>
+
+namespace QLogger
+{
+
+/**
+ * @brief The Field class is a typed key/value pair attached to a log message. The value is stored as it is given,
+ * so the call site doesn't format anything: the record is formatted with the layout of each destination when the
+ * manager dispatches it, before it is handed to the writer threads.
+ *
+ * @note The key is not copied, so it has to be a string literal. If it has characters that a JSON string has to
+ * escape, the escaped key is built once with the field.
+ */
+class Field
+{
+public:
+   /**
+    * @brief The Type enum class defines the type of the value.
+    */
+   enum class Type
+   {
+      Integer,
+      Double,
+      Bool,
+      String
+   };
+
+   Field() = default;
+
+   template<typename T,
+            typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+   Field(const char *key, T value)
+      : mKey(key)
+      , mType(Type::Integer)
+      , mInteger(static_cast<qint64>(value))
+   {
+      escapeKey();
+   }
+
+   Field(const char *key, double value)
+      : mKey(key)
+      , mType(Type::Double)
+      , mDouble(value)
+   {
+      escapeKey();
+   }
+
+   Field(const char *key, bool value)
+      : mKey(key)
+      , mType(Type::Bool)
+      , mBool(value)
+   {
+      escapeKey();
+   }
+
+   Field(const char *key, const QString &value)
+      : mKey(key)
+      , mType(Type::String)
+      , mString(value)
+   {
+      escapeKey();
+   }
+
+   Field(const char *key, const char *value)
+      : mKey(key)
+      , mType(Type::String)
+      , mString(QString::fromUtf8(value))
+   {
+      escapeKey();
+   }
+
+   const char *key() const noexcept { return mKey; }
+
+   /**
+    * @brief escapedKey Gets the key escaped for a JSON string, without the quotes.
+    */
+   const char *escapedKey() const noexcept { return mEscapedKey.isEmpty() ? mKey : mEscapedKey.constData(); }
+
+   Type type() const noexcept { return mType; }
+   qint64 toInteger() const noexcept { return mInteger; }
+   double toDouble() const noexcept { return mDouble; }
+   bool toBool() const noexcept { return mBool; }
+   const QString &toString() const noexcept { return mString; }
+
+private:
+   const char *mKey = "";
+   QByteArray mEscapedKey; //! @note Empty when the key doesn't need escaping, which is the usual case
+   Type mType = Type::Integer;
+   qint64 mInteger = 0;
+   double mDouble = 0;
+   bool mBool = false;
+   QString mString;
+
+   void escapeKey()
+   {
+      static const char hex[] = "0123456789abcdef";
+
+      auto iter = mKey;
+
+      while (*iter && static_cast<uchar>(*iter) >= 0x20 && *iter != '"' && *iter != '\\')
+         ++iter;
+
+      if (!*iter)
+         return;
+
+      mEscapedKey = QByteArray(mKey, static_cast<int>(iter - mKey));
+
+      for (; *iter; ++iter)
+      {
+         const auto c = static_cast<uchar>(*iter);
+
+         if (c == '"' || c == '\\')
+            mEscapedKey.append('\\').append(static_cast<char>(c));
+         else if (c < 0x20)
+            mEscapedKey.append("\\u00").append(hex[c >> 4]).append(hex[c & 0xF]);
+         else
+            mEscapedKey.append(static_cast<char>(c));
+      }
+   }
+};
+
+/**
+ * @brief The fields of a message. The first ones are stored inline, so a typical message doesn't allocate them.
+ */
+using Fields = QVarLengthArray<Field, 4>;
+
+}
+
+Q_DECLARE_METATYPE(QLogger::Fields)
@@ -0,0 +1,216 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerCallSite.h>
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <chrono>
+
+namespace QLogger
+{
+
+namespace Sampling
+{
+/**
+ * @brief Monotonic time in nanoseconds used by the rate limiters.
+ */
+inline qint64 nowNs() noexcept
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+       .count();
+}
+}
+
+/**
+ * @brief The EveryNSampler class lets through the first call and then one call out of every N. It is meant to be
+ * declared as a static object per call site (see QLog_EveryN).
+ */
+class EveryNSampler
+{
+public:
+   explicit EveryNSampler(quint64 n) noexcept
+      : mN(n > 0 ? n : 1)
+   {
+   }
+
+   /**
+    * @brief shouldLog Checks if the current call has to be logged.
+    * @return True one time out of N, otherwise false.
+    */
+   bool shouldLog() noexcept { return mCounter.fetch_add(1, std::memory_order_relaxed) % mN == 0; }
+
+private:
+   const quint64 mN;
+   std::atomic<quint64> mCounter { 0 };
+};
+
+/**
+ * @brief The FirstNThenPerSecondSampler class lets through the first N calls and after that at most one call per
+ * second.
+ */
+class FirstNThenPerSecondSampler
+{
+public:
+   explicit FirstNThenPerSecondSampler(quint64 n) noexcept
+      : mN(n)
+   {
+   }
+
+   /**
+    * @brief shouldLog Checks if the current call has to be logged.
+    * @return True for the first N calls or if the last logged call was more than one second ago.
+    */
+   bool shouldLog() noexcept
+   {
+      if (mCounter.load(std::memory_order_relaxed) < mN)
+      {
+         const auto count = mCounter.fetch_add(1, std::memory_order_relaxed);
+
+         // The second starts with the last call of the burst, otherwise the next call would always be logged
+         if (count + 1 == mN)
+            mLastNs.store(Sampling::nowNs(), std::memory_order_relaxed);
+
+         if (count < mN)
+            return true;
+      }
+
+      const auto now = Sampling::nowNs();
+      auto last = mLastNs.load(std::memory_order_relaxed);
+
+      return now - last >= kSecondNs && mLastNs.compare_exchange_strong(last, now, std::memory_order_relaxed);
+   }
+
+private:
+   static constexpr qint64 kSecondNs = 1000000000;
+   const quint64 mN;
+   std::atomic<quint64> mCounter { 0 };
+   std::atomic<qint64> mLastNs { 0 };
+};
+
+/**
+ * @brief The TokenBucketSampler class implements a token bucket rate limit using the generic cell rate algorithm:
+ * it allows a sustained rate of <em>ratePerSecond</em> calls with bursts of up to <em>burst</em> calls. The state
+ * is a single atomic so concurrent callers never block.
+ */
+class TokenBucketSampler
+{
+public:
+   TokenBucketSampler(double ratePerSecond, quint32 burst) noexcept
+      : mIntervalNs(ratePerSecond > 0 ? static_cast<qint64>(1e9 / ratePerSecond) : kNever)
+      , mToleranceNs(mIntervalNs * (burst > 0 ? burst - 1 : 0))
+   {
+   }
+
+   /**
+    * @brief shouldLog Consumes a token if there is one available.
+    * @return True if a token was available, otherwise false.
+    */
+   bool shouldLog() noexcept
+   {
+      if (mIntervalNs == kNever)
+         return false;
+
+      const auto now = Sampling::nowNs();
+      auto tat = mTheoreticalArrivalNs.load(std::memory_order_relaxed);
+
+      for (;;)
+      {
+         const auto base = tat > now ? tat : now;
+
+         if (base - now > mToleranceNs)
+            return false;
+
+         if (mTheoreticalArrivalNs.compare_exchange_weak(tat, base + mIntervalNs, std::memory_order_relaxed))
+            return true;
+      }
+   }
+
+private:
+   static constexpr qint64 kNever = -1;
+   const qint64 mIntervalNs;
+   const qint64 mToleranceNs;
+   std::atomic<qint64> mTheoreticalArrivalNs { 0 };
+};
+
+}
+
+#ifndef QLog_EveryN
+/**
+ * @brief Logs the first message and then one message out of every N from this call site. The message expression is
+ * not evaluated for the skipped calls.
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ * @param n The sampling period.
+ * @param message The message.
+ */
+#   define QLog_EveryN(module, level, n, message)                                                                      \
+      do                                                                                                               \
+      {                                                                                                                \
+         static QLogger::EveryNSampler qlogSampler(n);                                                                 \
+         static QLogger::CallSite qlogCallSite(__FILE__, __LINE__, __FUNCTION__, level);                               \
+         if (qlogCallSite.isEnabled() && qlogSampler.shouldLog())                                                      \
+            QLogger::QLoggerManager::getInstance()->enqueueMessage(qlogCallSite, module, message);                     \
+      } while (false)
+#endif
+
+#ifndef QLog_FirstNThenEverySecond
+/**
+ * @brief Logs the first N messages from this call site and then at most one message per second. The message
+ * expression is not evaluated for the skipped calls.
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ * @param n The number of messages logged before the limit applies.
+ * @param message The message.
+ */
+#   define QLog_FirstNThenEverySecond(module, level, n, message)                                                       \
+      do                                                                                                               \
+      {                                                                                                                \
+         static QLogger::FirstNThenPerSecondSampler qlogSampler(n);                                                    \
+         static QLogger::CallSite qlogCallSite(__FILE__, __LINE__, __FUNCTION__, level);                               \
+         if (qlogCallSite.isEnabled() && qlogSampler.shouldLog())                                                      \
+            QLogger::QLoggerManager::getInstance()->enqueueMessage(qlogCallSite, module, message);                     \
+      } while (false)
+#endif
+
+#ifndef QLog_RateLimited
+/**
+ * @brief Logs messages from this call site limited by a token bucket. The message expression is not evaluated for
+ * the skipped calls.
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ * @param ratePerSecond The sustained amount of messages per second.
+ * @param burst The maximum amount of messages logged in a burst.
+ * @param message The message.
+ */
+#   define QLog_RateLimited(module, level, ratePerSecond, burst, message)                                              \
+      do                                                                                                               \
+      {                                                                                                                \
+         static QLogger::TokenBucketSampler qlogSampler(ratePerSecond, burst);                                         \
+         static QLogger::CallSite qlogCallSite(__FILE__, __LINE__, __FUNCTION__, level);                               \
+         if (qlogCallSite.isEnabled() && qlogSampler.shouldLog())                                                      \
+            QLogger::QLoggerManager::getInstance()->enqueueMessage(qlogCallSite, module, message);                     \
+      } while (false)
+#endif
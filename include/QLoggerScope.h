@@ -0,0 +1,247 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerCallSite.h>
+#include <QLoggerSampling.h>
+
+#include <QString>
+#include <QtAlgorithms>
+
+#include <array>
+#include <atomic>
+
+namespace QLogger
+{
+
+/**
+ * @brief The LatencyHistogram class counts durations in buckets of logarithmic size with 16 linear sub-buckets per
+ * power of two, like an HDR histogram, so any percentile is known with a precision of about 6% from a few kilobytes.
+ * Recording a value is a handful of relaxed atomic operations and never blocks.
+ */
+class LatencyHistogram
+{
+public:
+   static constexpr int SUB_BUCKET_BITS = 4;
+   static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+   static constexpr int MAGNITUDES = 40; //! @note Values up to 2^44 ns (about 4.9 hours), longer ones are clamped
+   static constexpr int BUCKETS = SUB_BUCKETS + MAGNITUDES * SUB_BUCKETS;
+
+   /**
+    * @brief The Snapshot struct stores the values recorded since the previous snapshot.
+    */
+   struct Snapshot
+   {
+      std::array<quint64, BUCKETS> counts {};
+      quint64 count = 0;
+      quint64 sum = 0;
+      quint64 max = 0;
+
+      /**
+       * @brief percentile Gets the highest value of the bucket that contains the given percentile.
+       * @param fraction The percentile between 0 and 1.
+       */
+      quint64 percentile(double fraction) const noexcept
+      {
+         if (count == 0)
+            return 0;
+
+         const auto target = qMax<quint64>(1, static_cast<quint64>(fraction * count + 0.5));
+         quint64 accumulated = 0;
+
+         for (auto index = 0; index < BUCKETS; ++index)
+         {
+            accumulated += counts[index];
+
+            if (accumulated >= target)
+               return qMin(highestValue(index), max);
+         }
+
+         return max;
+      }
+   };
+
+   /**
+    * @brief record Adds a duration.
+    * @param value The duration in nanoseconds.
+    */
+   void record(quint64 value) noexcept
+   {
+      mBuckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+      mSum.fetch_add(value, std::memory_order_relaxed);
+
+      auto max = mMax.load(std::memory_order_relaxed);
+
+      while (value > max && !mMax.compare_exchange_weak(max, value, std::memory_order_relaxed))
+         ;
+   }
+
+   /**
+    * @brief takeSnapshot Gets the values recorded since the last snapshot and starts counting again.
+    */
+   Snapshot takeSnapshot() noexcept
+   {
+      Snapshot snapshot;
+
+      for (auto index = 0; index < BUCKETS; ++index)
+      {
+         if (mBuckets[index].load(std::memory_order_relaxed) == 0)
+            continue;
+
+         snapshot.counts[index] = mBuckets[index].exchange(0, std::memory_order_relaxed);
+         snapshot.count += snapshot.counts[index];
+      }
+
+      snapshot.sum = mSum.exchange(0, std::memory_order_relaxed);
+      snapshot.max = mMax.exchange(0, std::memory_order_relaxed);
+
+      return snapshot;
+   }
+
+   /**
+    * @brief bucketIndex Gets the bucket of a value: values under 16 have their own bucket, the rest go to one of the
+    * 16 sub-buckets of their power of two.
+    */
+   static int bucketIndex(quint64 value) noexcept
+   {
+      if (value < SUB_BUCKETS)
+         return static_cast<int>(value);
+
+      const auto magnitude = qMin(63 - static_cast<int>(qCountLeadingZeroBits(value)) - SUB_BUCKET_BITS,
+                                  MAGNITUDES - 1);
+      const auto subBucket = qMin<quint64>(value >> magnitude, 2 * SUB_BUCKETS - 1) - SUB_BUCKETS;
+
+      return SUB_BUCKETS + magnitude * SUB_BUCKETS + static_cast<int>(subBucket);
+   }
+
+   /**
+    * @brief highestValue Gets the highest value that is counted in a bucket.
+    */
+   static quint64 highestValue(int index) noexcept
+   {
+      if (index < SUB_BUCKETS)
+         return static_cast<quint64>(index);
+
+      const auto magnitude = (index - SUB_BUCKETS) / SUB_BUCKETS;
+      const auto subBucket = static_cast<quint64>((index - SUB_BUCKETS) % SUB_BUCKETS);
+
+      return ((SUB_BUCKETS + subBucket + 1) << magnitude) - 1;
+   }
+
+private:
+   std::array<std::atomic<quint64>, BUCKETS> mBuckets {};
+   std::atomic<quint64> mSum { 0 };
+   std::atomic<quint64> mMax { 0 };
+};
+
+/**
+ * @brief The ScopeSite class describes one expansion of QLog_Scope. It owns the histogram of the durations measured
+ * there and registers itself in the QLoggerManager, which periodically writes a summary of every site to the
+ * destination of its module.
+ */
+class ScopeSite
+{
+public:
+   /**
+    * @brief Constructor that registers the scope site.
+    * @param file The file of the scope.
+    * @param line The line of the scope.
+    * @param function The function of the scope.
+    * @param module The module that receives the summaries.
+    * @param name The name of the scope in the summaries.
+    */
+   ScopeSite(const char *file, int line, const char *function, const QString &module, const QString &name);
+
+   /**
+    * @brief Destructor that unregisters the scope site.
+    */
+   ~ScopeSite();
+
+   ScopeSite(const ScopeSite &) = delete;
+   ScopeSite &operator=(const ScopeSite &) = delete;
+
+   /**
+    * @brief isEnabled Checks if the durations have to be measured. It follows the Info call site of the scope.
+    */
+   bool isEnabled() const noexcept { return mCallSite.isEnabled(); }
+
+   void record(quint64 nanoseconds) noexcept { mHistogram.record(nanoseconds); }
+
+   const CallSite &callSite() const noexcept { return mCallSite; }
+   const QString &module() const noexcept { return mModule; }
+   const QString &name() const noexcept { return mName; }
+   LatencyHistogram &histogram() noexcept { return mHistogram; }
+
+private:
+   CallSite mCallSite;
+   const QString mModule;
+   const QString mName;
+   LatencyHistogram mHistogram;
+};
+
+/**
+ * @brief The ScopeTimer class measures the lifetime of a scope with a monotonic clock and records it in the
+ * histogram of its site.
+ */
+class ScopeTimer
+{
+public:
+   explicit ScopeTimer(ScopeSite &site) noexcept
+      : mSite(site.isEnabled() ? &site : nullptr)
+      , mStart(mSite ? Sampling::nowNs() : 0)
+   {
+   }
+
+   ~ScopeTimer()
+   {
+      if (mSite)
+         mSite->record(static_cast<quint64>(Sampling::nowNs() - mStart));
+   }
+
+   ScopeTimer(const ScopeTimer &) = delete;
+   ScopeTimer &operator=(const ScopeTimer &) = delete;
+
+private:
+   ScopeSite *const mSite;
+   const qint64 mStart;
+};
+
+}
+
+#ifndef QLog_Concat_
+#   define QLog_Concat__(a, b) a##b
+#   define QLog_Concat_(a, b) QLog_Concat__(a, b)
+#endif
+
+#ifndef QLog_Scope
+/**
+ * @brief Measures the time until the end of the enclosing scope. Instead of one line per measure, the durations are
+ * collected in a histogram and a summary with the count, p50, p99 and max is periodically written to the module
+ * (see QLoggerManager::setScopeReportInterval).
+ * @param module The module that receives the summaries.
+ * @param name The name of the scope in the summaries.
+ */
+#   define QLog_Scope(module, name)                                                                                    \
+      static QLogger::ScopeSite QLog_Concat_(qlogScopeSite, __LINE__)(__FILE__, __LINE__, __FUNCTION__, module,        \
+                                                                       name);                                          \
+      QLogger::ScopeTimer QLog_Concat_(qlogScopeTimer, __LINE__)(QLog_Concat_(qlogScopeSite, __LINE__))
+#endif
@@ -0,0 +1,187 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerCallSite.h>
+
+#include <QChar>
+#include <QLatin1String>
+#include <QString>
+#include <QVarLengthArray>
+
+namespace QLogger
+{
+
+/**
+ * @brief The MessageStream class builds a message with the stream operator and enqueues it when it is destroyed. The
+ * text is accumulated in an inline buffer, so short messages don't allocate memory until the final QString is created
+ * and handed to the queue. It is only meant to be created as a temporary by the QLog_*S macros.
+ */
+class MessageStream
+{
+public:
+   /**
+    * @brief Constructor.
+    * @param site The call site where the log comes from.
+    * @param module The module that writes the message. It has to outlive the stream.
+    */
+   MessageStream(const CallSite &site, const QString &module) noexcept
+      : mSite(site)
+      , mModule(module)
+   {
+   }
+
+   /**
+    * @brief Destructor that enqueues the message.
+    */
+   ~MessageStream();
+
+   MessageStream(const MessageStream &) = delete;
+   MessageStream &operator=(const MessageStream &) = delete;
+
+   /**
+    * @brief isWanted Checks if the message of an enabled call site is kept by the module, so the stream is not built
+    * for a module whose destinations have a higher level than the lowest one of all the destinations.
+    * @param site The call site where the log comes from.
+    * @param module The module that writes the message.
+    */
+   static bool isWanted(const CallSite &site, const QString &module);
+
+   MessageStream &operator<<(const QString &text)
+   {
+      mBuffer.append(text.constData(), text.size());
+      return *this;
+   }
+
+   MessageStream &operator<<(QLatin1String text)
+   {
+      for (const auto c : text)
+         mBuffer.append(QChar::fromLatin1(c));
+      return *this;
+   }
+
+   MessageStream &operator<<(const char *text);
+
+   MessageStream &operator<<(QChar c)
+   {
+      mBuffer.append(c);
+      return *this;
+   }
+
+   MessageStream &operator<<(char c)
+   {
+      mBuffer.append(QChar::fromLatin1(c));
+      return *this;
+   }
+
+   MessageStream &operator<<(bool value) { return *this << (value ? QLatin1String("true") : QLatin1String("false")); }
+
+   MessageStream &operator<<(short value) { return appendInteger(value); }
+   MessageStream &operator<<(unsigned short value) { return appendUnsigned(value); }
+   MessageStream &operator<<(int value) { return appendInteger(value); }
+   MessageStream &operator<<(unsigned int value) { return appendUnsigned(value); }
+   MessageStream &operator<<(long value) { return appendInteger(value); }
+   MessageStream &operator<<(unsigned long value) { return appendUnsigned(value); }
+   MessageStream &operator<<(long long value) { return appendInteger(value); }
+   MessageStream &operator<<(unsigned long long value) { return appendUnsigned(value); }
+
+   MessageStream &operator<<(float value) { return appendDouble(value); }
+   MessageStream &operator<<(double value) { return appendDouble(value); }
+
+   MessageStream &operator<<(const void *pointer);
+
+private:
+   const CallSite &mSite;
+   const QString &mModule;
+   QVarLengthArray<QChar, 256> mBuffer;
+
+   MessageStream &appendInteger(qint64 value);
+   MessageStream &appendUnsigned(quint64 value);
+   MessageStream &appendDouble(double value);
+   void appendAscii(const char *text, int length);
+};
+
+}
+
+#ifndef QLog_Stream_
+/**
+ * @brief Creates a MessageStream for the given module and level. The stream and the values passed to it are only
+ * evaluated if the call site is enabled and the module keeps the level. The module is evaluated once.
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ */
+#   define QLog_Stream_(module, level)                                                                                 \
+      for (bool qlogOnce = true; qlogOnce; qlogOnce = false)                                                           \
+         for (static QLogger::CallSite qlogCallSite(__FILE__, __LINE__, __FUNCTION__, level);                          \
+              qlogOnce && qlogCallSite.isEnabled(); qlogOnce = false)                                                  \
+            for (const QString &qlogModule = module;                                                                   \
+                 qlogOnce && QLogger::MessageStream::isWanted(qlogCallSite, qlogModule); qlogOnce = false)             \
+               QLogger::MessageStream(qlogCallSite, qlogModule)
+#endif
+
+#ifndef QLog_TraceS
+/**
+ * @brief Streams a Trace message: QLog_TraceS(module) << "user " << id;
+ * @param module The module that the message references.
+ */
+#   define QLog_TraceS(module) QLog_Stream_(module, QLogger::LogLevel::Trace)
+#endif
+
+#ifndef QLog_DebugS
+/**
+ * @brief Streams a Debug message: QLog_DebugS(module) << "user " << id;
+ * @param module The module that the message references.
+ */
+#   define QLog_DebugS(module) QLog_Stream_(module, QLogger::LogLevel::Debug)
+#endif
+
+#ifndef QLog_InfoS
+/**
+ * @brief Streams an Info message: QLog_InfoS(module) << "user " << id;
+ * @param module The module that the message references.
+ */
+#   define QLog_InfoS(module) QLog_Stream_(module, QLogger::LogLevel::Info)
+#endif
+
+#ifndef QLog_WarningS
+/**
+ * @brief Streams a Warning message: QLog_WarningS(module) << "user " << id;
+ * @param module The module that the message references.
+ */
+#   define QLog_WarningS(module) QLog_Stream_(module, QLogger::LogLevel::Warning)
+#endif
+
+#ifndef QLog_ErrorS
+/**
+ * @brief Streams an Error message: QLog_ErrorS(module) << "user " << id;
+ * @param module The module that the message references.
+ */
+#   define QLog_ErrorS(module) QLog_Stream_(module, QLogger::LogLevel::Error)
+#endif
+
+#ifndef QLog_FatalS
+/**
+ * @brief Streams a Fatal message: QLog_FatalS(module) << "user " << id;
+ * @param module The module that the message references.
+ */
+#   define QLog_FatalS(module) QLog_Stream_(module, QLogger::LogLevel::Fatal)
+#endif
@@ -63,6 +63,25 @@ enum class LogFileDisplay
    Number
 };
 
+/**
+ * @brief The LogRotation enum class defines when the log file is rotated besides reaching the maximum size.
+ */
+enum class LogRotation
+{
+   Size = 0,
+   Hourly,
+   Daily
+};
+
+/**
+ * @brief The LogSocketFraming enum class defines how a socket destination frames the messages.
+ */
+enum class LogSocketFraming
+{
+   LengthPrefixed, //! @note 32-bit big endian length followed by the UTF-8 message
+   Syslog //! @note RFC 5424 messages, with octet counting (RFC 6587) on stream sockets
+};
+
 /**
  * @brief The LogTextDisplay enum class defines which elements are written by log message.
  */
@@ -76,6 +95,8 @@ enum class LogMessageDisplay : unsigned int
    File = 1 << 5,
    Line = 1 << 6,
    Message = 1 << 7,
+   Sequence = 1 << 8, //! @note Process-wide sequence number, needed to restore the original order of the messages
+   Json = 1 << 9, //! @note One JSON object per line with all the information of the record. Other options are ignored
    Default = LogLevel | ModuleName | DateTime | ThreadId | File | Line | Message,
    Default2 = LogLevel | ModuleName | DateTime | ThreadId | File | Function | Message,
    Full = 0xFF
@@ -84,4 +105,15 @@ enum class LogMessageDisplay : unsigned int
 Q_DECLARE_FLAGS(LogMessageDisplays, LogMessageDisplay)
 Q_DECLARE_OPERATORS_FOR_FLAGS(LogMessageDisplays)
 
+/**
+ * @brief The RetentionPolicy struct defines the limits applied to the rotated log files of a folder. The oldest
+ * files are deleted first. A negative value disables the limit.
+ */
+struct RetentionPolicy
+{
+   int maxAgeDays = -1;
+   qint64 maxTotalBytes = -1;
+   int maxFileCount = -1;
+};
+
 }
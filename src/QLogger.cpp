@@ -1,9 +1,25 @@
 #include <QLogger>
 
 #include "QLoggerWriter.h"
+#include "QLoggerRoutingTable.h"
+#include "QLoggerRecord.h"
+#include "QLoggerBufferPool.h"
+#include "QLoggerMemoryBudget.h"
+#include "QLoggerPauseBuffer.h"
+#include "QLoggerScopeReporter.h"
+#include "QLoggerVolumeReporter.h"
+#include "QLoggerFlightRecorder.h"
+#include "QLoggerSharedRing.h"
+#include "QLoggerSocketWriter.h"
+#include "QLoggerRetention.h"
 
 #include <QDateTime>
 #include <QDir>
+#include <QSet>
+#include <QThreadPool>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 Q_DECLARE_METATYPE(QLogger::LogLevel)
 Q_DECLARE_METATYPE(QLogger::LogMode)
@@ -21,6 +37,84 @@ void QLog_(const QString &module, LogLevel level, const QString &message, const
 
 static const int QUEUE_LIMIT = 100;
 
+/**
+ * @brief Records sent to the destinations per lock when the pause buffer is drained.
+ */
+static const int PAUSE_BATCH_SIZE = 4096;
+
+/**
+ * @brief Gets the identifier of the current thread. It is formatted once per thread.
+ */
+static const QString &currentThreadId()
+{
+   thread_local const QString threadId
+       = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
+
+   return threadId;
+}
+
+/**
+ * @brief Gets the absolute and clean path of a folder, used as key of the retention services.
+ */
+static QString normalizedFolder(const QString &folder)
+{
+   return QDir::cleanPath(QDir(folder).absolutePath());
+}
+
+/**
+ * @brief Whether the current thread is inside QLogger. Used to avoid routing the Qt messages printed by QLogger
+ * itself (or by the listeners) back into QLogger.
+ */
+thread_local bool tlsInsideLogger = false;
+
+/**
+ * @brief RAII helper that marks the current thread as inside QLogger.
+ */
+class ReentrancyGuard
+{
+public:
+   ReentrancyGuard()
+      : mWasInside(tlsInsideLogger)
+   {
+      tlsInsideLogger = true;
+   }
+   ~ReentrancyGuard() { tlsInsideLogger = mWasInside; }
+
+private:
+   bool mWasInside;
+};
+
+/**
+ * @brief Maps the Qt message type to the log level.
+ */
+static LogLevel qtMessageTypeToLevel(QtMsgType type)
+{
+   switch (type)
+   {
+      case QtDebugMsg:
+         return LogLevel::Debug;
+      case QtInfoMsg:
+         return LogLevel::Info;
+      case QtWarningMsg:
+         return LogLevel::Warning;
+      case QtCriticalMsg:
+         return LogLevel::Error;
+      case QtFatalMsg:
+         return LogLevel::Fatal;
+   }
+
+   return LogLevel::Debug;
+}
+
+QLoggerManager::QLoggerManager()
+{
+   // The singletons used by the writers and the manager have to outlive it: the writers give their buffers and
+   // their memory back while they are closed, even the ones that miss the shutdown deadline
+   QLoggerBufferPool::getInstance();
+   QLoggerMemoryBudget::getInstance();
+   CallSiteRegistry::getInstance();
+}
+
 QLoggerManager *QLoggerManager::getInstance()
 {
    static QLoggerManager INSTANCE;
@@ -34,18 +128,13 @@ bool QLoggerManager::addDestination(const QString &fileDest, const QString &modu
 {
    QMutexLocker lock(&mMutex);
 
-   if (!mModuleDest.contains(module))
-   {
-      const auto log = createWriter(fileDest, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions);
-
-      mModuleDest.insert(module, log);
+   const auto writer
+       = addWriter(fileDest, module, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions, notify);
 
-      startWriter(module, log, mode, notify);
-
-      return true;
-   }
+   if (writer)
+      addRoute(module, { writer, level });
 
-   return false;
+   return writer != nullptr;
 }
 
 bool QLoggerManager::addDestination(const QString &fileDest, const QStringList &modules, LogLevel level,
@@ -57,26 +146,114 @@ bool QLoggerManager::addDestination(const QString &fileDest, const QStringList &
 
    for (const auto &module : modules)
    {
-      if (!mModuleDest.contains(module))
+      if (const auto writer
+          = addWriter(fileDest, module, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions, notify))
       {
-         const auto log = createWriter(fileDest, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions);
+         addRoute(module, { writer, level });
+         allAdded = true;
+      }
+   }
 
-         mModuleDest.insert(module, log);
+   return allAdded;
+}
 
-         startWriter(module, log, mode, notify);
+QLoggerWriter *QLoggerManager::addWriter(const QString &fileDest, const QString &module, LogLevel level,
+                                         const QString &fileFolderDestination, LogMode mode,
+                                         LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions,
+                                         bool notify)
+{
+   const auto log = createWriter(fileDest, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions);
+   const auto moduleDestinations = mModuleDest.values(module);
 
-         allAdded = true;
+   for (const auto &destination : moduleDestinations)
+   {
+      if (destination.writer->getFileDestination() == log->getFileDestination())
+      {
+         delete log;
+         return nullptr;
       }
    }
 
-   return allAdded;
+   // The writer keeps its file open and is the only one that rotates it, so the modules of a file share its writer.
+   // Each module keeps its own level, but the lines of a file have a single mode and layout.
+   if (const auto writer = mFileWriters.value(log->getFileDestination(), nullptr))
+   {
+      const auto isCompatible
+          = writer->getMode() == log->getMode() && writer->getMessageOptions() == log->getMessageOptions();
+
+      if (!isCompatible)
+      {
+         qWarning("QLogger: %s is already used with another mode or message options, %s is not added to it",
+                  qPrintable(log->getFileDestination()), qPrintable(module));
+      }
+
+      delete log;
+
+      if (!isCompatible)
+         return nullptr;
+
+      writer->setLogLevel(qMin(writer->getLevel(), level));
+      mModuleDest.insert(module, { writer, level });
+
+      return writer;
+   }
+
+   const auto folder = normalizedFolder(log->getFileDestinationFolder());
+
+   log->setRotationCallback([this, folder](const QString &filePath) { notifyFileRotated(folder, filePath); });
+
+   {
+      QMutexLocker retentionLock(&mRetentionMutex);
+
+      if (const auto retention = mRetention.value(folder, nullptr))
+      {
+         retention->addActiveFile(log->getFileDestination());
+         retention->addActiveFile(log->getNextFileDestination());
+      }
+   }
+
+   mModuleDest.insert(module, { log, level });
+   mFileWriters.insert(log->getFileDestination(), log);
+
+   startWriter(module, log, notify);
+
+   return log;
+}
+
+bool QLoggerManager::addSocketDestination(const QString &address, const QString &module, LogLevel level,
+                                          LogSocketFraming framing, LogMessageDisplays messageOptions)
+{
+   QMutexLocker lock(&mMutex);
+
+   const auto moduleDestinations = mModuleDest.values(module);
+
+   for (const auto &destination : moduleDestinations)
+   {
+      if (destination.writer->getFileDestination() == address)
+         return false;
+   }
+
+   const auto log = new QLoggerSocketWriter(address, level, framing, messageOptions);
+
+   if (!log->isValid())
+   {
+      delete log;
+      return false;
+   }
+
+   mModuleDest.insert(module, { log, level });
+
+   startWriter(module, log, false);
+   addRoute(module, { log, level });
+
+   return true;
 }
 
 uint64_t QLoggerManager::addListener(std::function<void (const QString &)> callback, LogLevel level)
 {
     QMutexLocker lock(&mCallbacksMutex);
 
-    mCallbacks.insert(++mListenerId, std::move(callback));
+    mCallbacks.insert(++mListenerId, { level, std::move(callback) });
 
     return mListenerId;
 }
@@ -87,13 +264,72 @@ void QLoggerManager::removeListener(uint64_t id)
     mCallbacks.remove(id);
 }
 
-void QLoggerManager::notifyListener(const QString& text)
+void QLoggerManager::installQtMessageHandler(const QString &defaultModule)
+{
+   QMutexLocker lock(&mQtHandlerMutex);
+
+   mQtDefaultModule = defaultModule;
+
+   if (!mQtHandlerInstalled)
+   {
+      mPreviousQtHandler = qInstallMessageHandler(&QLoggerManager::qtMessageHandler);
+      mQtHandlerInstalled = true;
+   }
+}
+
+void QLoggerManager::uninstallQtMessageHandler()
+{
+   QMutexLocker lock(&mQtHandlerMutex);
+
+   if (mQtHandlerInstalled)
+   {
+      qInstallMessageHandler(mPreviousQtHandler);
+      mPreviousQtHandler = nullptr;
+      mQtHandlerInstalled = false;
+   }
+}
+
+void QLoggerManager::qtMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+   const auto manager = getInstance();
+
+   QtMessageHandler previousHandler = nullptr;
+   QString defaultModule;
+
+   // The handler may be called from any thread while it is being installed or uninstalled
+   {
+      QMutexLocker lock(&manager->mQtHandlerMutex);
+      previousHandler = manager->mPreviousQtHandler;
+      defaultModule = manager->mQtDefaultModule;
+   }
+
+   const auto insideLogger = tlsInsideLogger || QLoggerWriter::isWriterThread();
+
+   // Messages printed by QLogger itself go to the previous handler: they would loop otherwise. Fatal messages are
+   // printed as well since the application aborts right after.
+   if ((insideLogger || type == QtFatalMsg) && previousHandler)
+      previousHandler(type, context, message);
+
+   if (insideLogger)
+      return;
+
+   ReentrancyGuard guard;
+
+   const auto category = QLatin1String(context.category);
+   const auto module = category.isEmpty() || category == QLatin1String("default") ? defaultModule : QString(category);
+
+   manager->enqueueMessage(module, qtMessageTypeToLevel(type), message, QString::fromUtf8(context.function),
+                           QString::fromUtf8(context.file), context.line);
+}
+
+void QLoggerManager::notifyListener(LogLevel level, const QString& text)
 {
     QMutexLocker lock(&mCallbacksMutex);
 
-    for (auto& callback : mCallbacks)
+    for (auto& listener : mCallbacks)
     {
-        callback(text);
+        if (listener.level <= level)
+            listener.callback(text);
     }
 }
 
@@ -109,28 +345,43 @@ QLoggerWriter *QLoggerManager::createWriter(const QString &fileDest, LogLevel le
    const auto lMode = mode == LogMode::OnlyFile ? mDefaultMode : mode;
    const auto lFileSuffixIfFull
        = fileSuffixIfFull == LogFileDisplay::DateTime ? mDefaultFileSuffixIfFull : fileSuffixIfFull;
-   const auto lMessageOptions
-       = messageOptions.testFlag(LogMessageDisplay::Default) ? mDefaultMessageOptions : messageOptions;
+   // Only the exact Default preset takes the manager default, so Default | Sequence keeps its sequence number
+   const auto lMessageOptions = messageOptions == LogMessageDisplays(LogMessageDisplay::Default)
+       ? mDefaultMessageOptions
+       : messageOptions;
 
    const auto log
        = new QLoggerWriter(lFileDest, lLevel, lFileFolderDestination, lMode, lFileSuffixIfFull, lMessageOptions);
 
    log->setMaxFileSize(mDefaultMaxFileSize);
+   log->setMaxRotatedFiles(mDefaultMaxRotatedFiles);
+   log->setRotation(mDefaultRotation);
+   log->setIndexBlockSize(mDefaultIndexBlockSize);
+   log->setBatchDelay(mDefaultBatchDelay);
    log->stop(mIsStop);
 
    return log;
 }
 
-void QLoggerManager::startWriter(const QString &module, QLoggerWriter *log, LogMode mode, bool notify)
+void QLoggerManager::startWriter(const QString &module, QLoggerWriter *log, bool notify)
 {
+   QString startupMessage;
+
    if (notify)
    {
-      const auto threadId = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
-      log->enqueue(QDateTime::currentDateTime(), threadId, module, LogLevel::Info, "", "", -1, "Adding destination!");
+      QLoggerRecord record;
+      record.timestamp = QDateTime::currentMSecsSinceEpoch();
+      record.threadId = currentThreadId();
+      record.module = module;
+      record.level = LogLevel::Info;
+      record.message = QStringLiteral("Adding destination!");
+      record.sequence = ++mSequence;
+
+      startupMessage = log->format(record);
    }
 
-   if (mode != LogMode::Disabled)
-      log->start();
+   // The thread, the folder and the file are only created when the destination gets its first message
+   log->startOnFirstMessage(startupMessage);
 }
 
 void QLoggerManager::clearFileDestinationFolder(const QString &fileFolderDestination, int days)
@@ -155,6 +406,174 @@ void QLoggerManager::clearFileDestinationFolder(const QString &fileFolderDestina
    }
 }
 
+void QLoggerManager::setRetentionPolicy(const QString &fileFolderDestination, const RetentionPolicy &policy)
+{
+   QMutexLocker lock(&mMutex);
+
+   auto folder = fileFolderDestination.isEmpty() ? mDefaultFileDestinationFolder : fileFolderDestination;
+
+   if (folder.isEmpty())
+      folder = QDir::currentPath() + "/logs/";
+
+   folder = normalizedFolder(folder);
+
+   QMutexLocker retentionLock(&mRetentionMutex);
+
+   if (const auto retention = mRetention.value(folder, nullptr))
+   {
+      retention->setPolicy(policy);
+      return;
+   }
+
+   const auto retention = new QLoggerRetention(folder, policy);
+
+   for (const auto logWriter : uniqueWriters())
+   {
+      if (normalizedFolder(logWriter->getFileDestinationFolder()) == folder)
+      {
+         retention->addActiveFile(logWriter->getFileDestination());
+         retention->addActiveFile(logWriter->getNextFileDestination());
+      }
+   }
+
+   mRetention.insert(folder, retention);
+
+   retention->start(QThread::IdlePriority);
+}
+
+void QLoggerManager::notifyFileRotated(const QString &folder, const QString &filePath)
+{
+   QMutexLocker retentionLock(&mRetentionMutex);
+
+   if (const auto retention = mRetention.value(folder, nullptr))
+      retention->fileRotated(filePath);
+}
+
+void QLoggerManager::setDefaultLevel(LogLevel level)
+{
+   QMutexLocker lock(&mMutex);
+
+   mDefaultLevel = level;
+
+   updateCallSiteThreshold();
+}
+
+void QLoggerManager::setQueueUnroutedMessages(bool queue)
+{
+   QMutexLocker lock(&mMutex);
+
+   mQueueUnroutedMessages = queue;
+
+   updateCallSiteThreshold();
+}
+
+void QLoggerManager::setMaxPooledMessageSize(int size)
+{
+   QLoggerBufferPool::getInstance()->setMaxBufferSize(size);
+}
+
+void QLoggerManager::setMemoryBudget(qint64 bytes)
+{
+   QLoggerMemoryBudget::getInstance()->setLimit(bytes);
+}
+
+void QLoggerManager::setMemoryReservation(LogLevel level, qint64 bytes)
+{
+   QLoggerMemoryBudget::getInstance()->setReservation(level, bytes);
+}
+
+MemoryStatistics QLoggerManager::getMemoryStatistics() const
+{
+   return QLoggerMemoryBudget::getInstance()->statistics();
+}
+
+void QLoggerManager::setScopeReportInterval(int msecs)
+{
+   QMutexLocker lock(&mScopeMutex);
+
+   mScopeReportInterval = msecs;
+
+   if (mScopeReporter)
+      mScopeReporter->setInterval(msecs);
+}
+
+void QLoggerManager::reportScopes()
+{
+   QMutexLocker lock(&mScopeMutex);
+
+   if (mScopeReporter)
+      mScopeReporter->report();
+}
+
+void QLoggerManager::setVolumeReport(const QString &module, int msecs, int count)
+{
+   QMutexLocker lock(&mScopeMutex);
+
+   if (msecs <= 0)
+   {
+      if (mVolumeReporter)
+      {
+         mVolumeReporter->closeReporter();
+         mVolumeReporter->wait();
+         delete mVolumeReporter;
+         mVolumeReporter = nullptr;
+      }
+
+      return;
+   }
+
+   if (mVolumeReporter)
+      mVolumeReporter->configure(module, msecs, count);
+   else
+   {
+      mVolumeReporter = new QLoggerVolumeReporter(module, msecs, count);
+      mVolumeReporter->start(QThread::LowPriority);
+   }
+}
+
+void QLoggerManager::reportVolume(const QString &module, int count)
+{
+   const auto sites = CallSiteRegistry::getInstance()->topSites(count);
+
+   // The report doesn't come from a call site, so it doesn't add to the volume it describes
+   for (auto i = 0; i < sites.count(); ++i)
+   {
+      const auto &site = sites.at(i);
+      const auto fileName = site.file.mid(site.file.lastIndexOf('/') + 1);
+
+      Fields fields;
+      fields.append({ "rank", i + 1 });
+      fields.append({ "file", fileName });
+      fields.append({ "line", site.line });
+      fields.append({ "function", site.function });
+      fields.append({ "messages", site.messages });
+      fields.append({ "characters", site.characters });
+
+      enqueue(module, LogLevel::Info, QStringLiteral("Log volume"), QString(), QString(), -1, false, fields);
+   }
+}
+
+void QLoggerManager::registerScopeSite(ScopeSite *site)
+{
+   QMutexLocker lock(&mScopeMutex);
+
+   if (!mScopeReporter)
+   {
+      mScopeReporter = new QLoggerScopeReporter(mScopeReportInterval);
+      mScopeReporter->start(QThread::LowPriority);
+   }
+
+   mScopeReporter->addSite(site);
+}
+
+void QLoggerManager::unregisterScopeSite(ScopeSite *site)
+{
+   QMutexLocker lock(&mScopeMutex);
+
+   if (mScopeReporter)
+      mScopeReporter->removeSite(site);
+}
+
 void QLoggerManager::setDefaultFileDestinationFolder(const QString &fileDestinationFolder)
 {
    mDefaultFileDestinationFolder = QDir::fromNativeSeparators(fileDestinationFolder);
@@ -164,62 +583,359 @@ void QLoggerManager::writeAndDequeueMessages(const QString &module)
 {
    QMutexLocker lock(&mMutex);
 
-   const auto logWriter = mModuleDest.value(module, nullptr);
+   const auto destinations = mRoutes ? mRoutes->route(module).destinations : QVector<QLoggerDestination>();
 
-   if (logWriter && !logWriter->isStop())
+   if (!destinations.isEmpty() && !destinations.constFirst().writer->isStop())
    {
+      const auto budget = QLoggerMemoryBudget::getInstance();
       const auto values = mNonWriterQueue.values(module);
 
       for (const auto &vals : values)
       {
-         const auto level = qvariant_cast<LogLevel>(vals.at(2).toInt());
-
-         if (logWriter->getLevel() <= level)
-         {
-            const auto datetime = vals.at(0).toDateTime();
-            const auto threadId = vals.at(1).toString();
-            const auto function = vals.at(3).toString();
-            const auto file = vals.at(4).toString();
-            const auto line = vals.at(5).toInt();
-            const auto message = vals.at(6).toString();
-
-            logWriter->enqueue(datetime, threadId, module, level, function, file, line, message, [this](const QString& text){
-                notifyListener(text);
-            });
-         }
+         QLoggerRecord record;
+         record.timestamp = vals.at(0).toLongLong();
+         record.threadId = vals.at(1).toString();
+         record.module = module;
+         record.level = qvariant_cast<LogLevel>(vals.at(2).toInt());
+         record.function = vals.at(3).toString();
+         record.fileName = vals.at(4).toString();
+         record.line = vals.at(5).toInt();
+         record.message = vals.at(6).toString();
+         record.sequence = vals.at(7).toULongLong();
+         record.fields = vals.at(8).value<Fields>();
+
+         budget->release(QLoggerMemoryBudget::messageCost(record.message));
+
+         dispatch(record, destinations, false);
       }
 
       mNonWriterQueue.remove(module);
    }
 }
 
+void QLoggerManager::dispatch(const QLoggerRecord &record, const QVector<QLoggerDestination> &destinations,
+                              bool force, bool priority)
+{
+   QVarLengthArray<QPair<quint32, QString>, 4> layouts;
+
+   for (const auto &destination : destinations)
+   {
+      const auto writer = destination.writer;
+
+      if (writer->getMode() == LogMode::Disabled || writer->isStop() || (!force && destination.level > record.level))
+         continue;
+
+      const auto key = writer->layoutKey();
+      auto layout = std::find_if(layouts.begin(), layouts.end(),
+                                 [key](const QPair<quint32, QString> &item) { return item.first == key; });
+
+      if (layout == layouts.end())
+      {
+         layouts.append(qMakePair(key, QLoggerBufferPool::getInstance()->acquire()));
+         layout = layouts.end() - 1;
+
+         writer->format(record, layout->second);
+      }
+
+      writer->enqueue(layout->second, record.level, record.timestamp, priority);
+   }
+
+   if (!layouts.isEmpty())
+      notifyListener(record.level, layouts.at(0).second);
+}
+
+void QLoggerManager::writeFlightRecorder(QLoggerFlightRecorder *recorder,
+                                         const QVector<QLoggerDestination> &destinations)
+{
+   const auto records = recorder->takeRecords();
+
+   // The context goes to the priority lane too, so it is written before the Error that triggered the dump
+   for (const auto &record : records)
+   {
+      if (mIsBuffering)
+         mPauseBuffer->push(record, true, true);
+      else
+         dispatch(record, destinations, true, true);
+   }
+}
+
+bool QLoggerManager::drainPauseBuffer()
+{
+   QMutexLocker lock(&mMutex);
+
+   const auto batch = mPauseBuffer->takeBatch(PAUSE_BATCH_SIZE);
+
+   // The routes are looked up again, since the destinations may have changed while paused
+   for (const auto &entry : batch)
+   {
+      const auto destinations
+          = mRoutes ? mRoutes->route(entry.record.module).destinations : QVector<QLoggerDestination>();
+      dispatch(entry.record, destinations, entry.force, entry.priority);
+   }
+
+   if (!mPauseBuffer->isEmpty())
+      return false;
+
+   // The batch has been formatted already, so the keys of its fields are not needed anymore
+   mPauseBuffer->releaseKeys();
+   mIsBuffering = false;
+
+   return true;
+}
+
+void QLoggerManager::enableFlightRecorder(const QString &module, int capacity)
+{
+   QMutexLocker lock(&mMutex);
+
+   delete mFlightRecorders.take(module);
+   mFlightRecorders.insert(module, new QLoggerFlightRecorder(capacity));
+
+   updateRecordedModules();
+}
+
+void QLoggerManager::disableFlightRecorder(const QString &module)
+{
+   QMutexLocker lock(&mMutex);
+
+   delete mFlightRecorders.take(module);
+
+   updateRecordedModules();
+}
+
+void QLoggerManager::dumpFlightRecorder(const QString &module)
+{
+   QMutexLocker lock(&mMutex);
+
+   for (auto iter = mFlightRecorders.cbegin(); iter != mFlightRecorders.cend(); ++iter)
+   {
+      if (!module.isEmpty() && iter.key() != module)
+         continue;
+
+      const auto route = mRoutes ? mRoutes->route(iter.key()) : QLoggerRoutingTable::Route();
+
+      if (!route.destinations.isEmpty())
+         writeFlightRecorder(iter.value(), route.destinations);
+   }
+}
+
+bool QLoggerManager::enableSharedMemoryMode(const QString &key)
+{
+   const auto ring = new QLoggerSharedRing(key);
+
+   if (!ring->attach())
+   {
+      delete ring;
+      return false;
+   }
+
+   QMutexLocker lock(&mMutex);
+
+   delete mSharedRing;
+   mSharedRing = ring;
+
+   updateCallSiteThreshold();
+
+   return true;
+}
+
+void QLoggerManager::disableSharedMemoryMode()
+{
+   QMutexLocker lock(&mMutex);
+
+   delete mSharedRing;
+   mSharedRing = nullptr;
+
+   updateCallSiteThreshold();
+}
+
 void QLoggerManager::enqueueMessage(const QString &module, LogLevel level, const QString &message,
                                     const QString &function, const QString &file, int line)
 {
+   // Without a static call site, the registry keeps one per location so the volume is counted as well
+   const auto site = file.isEmpty() ? nullptr : CallSiteRegistry::getInstance()->siteFor(file, line, function, level);
+
+   if (site && !site->isEnabled())
+      return;
+
+   enqueue(module, level, message, function, file.mid(file.lastIndexOf('/') + 1), line, site && site->isForced(),
+           Fields(), site);
+}
+
+void QLoggerManager::enqueueMessage(const CallSite &site, const QString &module, const QString &message)
+{
+   enqueue(module, site.level(), message, site.functionName(), site.fileName(), site.line(), site.isForced(), Fields(),
+           &site);
+}
+
+void QLoggerManager::enqueueMessage(const CallSite &site, const QString &module, const QString &message,
+                                    std::initializer_list<Field> fields)
+{
+   Fields values;
+   values.append(fields.begin(), static_cast<int>(fields.size()));
+
+   enqueue(module, site.level(), message, site.functionName(), site.fileName(), site.line(), site.isForced(), values,
+           &site);
+}
+
+bool QLoggerManager::isLevelEnabled(const QString &module, LogLevel level) const
+{
+   QMutexLocker lock(&mMutex);
+
+   if (mSharedRing)
+      return level >= mDefaultLevel;
+
+   if (level <= LogLevel::Debug && mFlightRecorders.contains(module))
+      return true;
+
+   const auto route = mRoutes ? mRoutes->route(module) : QLoggerRoutingTable::Route();
+
+   if (!route.destinations.isEmpty())
+      return level >= route.level;
+
+   return mQueueUnroutedMessages && mNonWriterQueue.count(module) < QUEUE_LIMIT;
+}
+
+void QLoggerManager::enqueue(const QString &module, LogLevel level, const QString &message, const QString &function,
+                             const QString &fileName, int line, bool force, const Fields &fields,
+                             const CallSite *site)
+{
+   ReentrancyGuard guard;
    QMutexLocker lock(&mMutex);
-   const auto logWriter = mModuleDest.value(module, nullptr);
-   const auto isLogEnabled = logWriter && logWriter->getMode() != LogMode::Disabled && !logWriter->isStop();
 
-   if (isLogEnabled && logWriter->getLevel() <= level)
+   // In shared memory mode the collector process writes the messages
+   if (mSharedRing)
    {
-      const auto threadId = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
-      const auto fileName = file.mid(file.lastIndexOf('/') + 1);
+      if (force || level >= mDefaultLevel)
+      {
+         if (site)
+            site->countMessage(message.size());
 
-      writeAndDequeueMessages(module);
+         // The ring only stores text, so the fields are appended to the message
+         auto text = message;
+         QLoggerWriter::appendFields(text, fields);
+
+         mSharedRing->push({ QDateTime::currentMSecsSinceEpoch(), currentThreadId(), module, level, function, fileName,
+                             line, text, ++mSequence });
+      }
+
+      return;
+   }
 
-      logWriter->enqueue(QDateTime::currentDateTime(), threadId, module, level, function, fileName, line, message, [this](const QString& text){
-          notifyListener(text);
-      });
+   const auto route = mRoutes ? mRoutes->route(module) : QLoggerRoutingTable::Route();
+   const auto recorder = mFlightRecorders.isEmpty() ? nullptr : mFlightRecorders.value(module, nullptr);
+
+   // The Trace and Debug messages of a module with a flight recorder stay in memory until they are needed
+   if (recorder && level <= LogLevel::Debug)
+   {
+      recorder->record({ QDateTime::currentMSecsSinceEpoch(), currentThreadId(), module, level, function, fileName,
+                         line, message, ++mSequence, fields });
+      return;
    }
-   else if (!logWriter && mNonWriterQueue.count(module) < QUEUE_LIMIT)
+
+   if (!route.destinations.isEmpty())
    {
-      const auto threadId = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
-      const auto fileName = file.mid(file.lastIndexOf('/') + 1);
+      if (!force && route.level > level)
+         return;
+
+      // Only the messages that reach a destination count as volume
+      if (site)
+         site->countMessage(message.size());
+
+      if (!mNonWriterQueue.isEmpty())
+         writeAndDequeueMessages(module);
+
+      if (recorder && level >= LogLevel::Error)
+         writeFlightRecorder(recorder, route.destinations);
 
+      const QLoggerRecord record { QDateTime::currentMSecsSinceEpoch(), currentThreadId(), module, level, function,
+                                   fileName, line, message, ++mSequence, fields };
+
+      // While paused, and until the buffer is drained after resume, the records wait in order in the pause buffer
+      if (mIsBuffering)
+         mPauseBuffer->push(record, force);
+      else
+         dispatch(record, route.destinations, force);
+   }
+   else if (mQueueUnroutedMessages && mNonWriterQueue.count(module) < QUEUE_LIMIT
+            && QLoggerMemoryBudget::getInstance()->acquire(QLoggerMemoryBudget::messageCost(message), level))
+   {
       mNonWriterQueue.insert(module,
-                             { QDateTime::currentDateTime(), threadId, QVariant::fromValue<LogLevel>(level), function,
-                               fileName, line, message });
+                             { QDateTime::currentMSecsSinceEpoch(), currentThreadId(),
+                               QVariant::fromValue<LogLevel>(level), function, fileName, line, message, ++mSequence,
+                               QVariant::fromValue(fields) });
+   }
+}
+
+void QLoggerManager::updateCallSiteThreshold()
+{
+   QMutexLocker lock(&mMutex);
+
+   auto threshold = mDefaultLevel;
+
+   if (mRoutes)
+      threshold = qMin(threshold, mRoutes->lowestLevel());
+
+   // A module without destination keeps its messages, and the destination added later may accept any level
+   if (mQueueUnroutedMessages && !mSharedRing && !(mRoutes && mRoutes->hasCatchAll()))
+      threshold = LogLevel::Trace;
+
+   CallSiteRegistry::getInstance()->setThreshold(threshold);
+}
+
+void QLoggerManager::updateRecordedModules()
+{
+   QMutexLocker lock(&mMutex);
+
+   CallSiteRegistry::getInstance()->setRecording(!mFlightRecorders.isEmpty());
+}
+
+void QLoggerManager::rebuildRoutes()
+{
+   QMutexLocker lock(&mMutex);
+
+   mRoutes = std::make_unique<QLoggerRoutingTable>(mModuleDest);
+
+   const auto queuedModules = mNonWriterQueue.uniqueKeys();
+
+   for (const auto &module : queuedModules)
+      writeAndDequeueMessages(module);
+
+   updateCallSiteThreshold();
+}
+
+void QLoggerManager::addRoute(const QString &module, const QLoggerDestination &destination)
+{
+   QMutexLocker lock(&mMutex);
+
+   if (!mRoutes)
+      mRoutes = std::make_unique<QLoggerRoutingTable>();
+
+   mRoutes->addDestination(module, destination);
+
+   // Only the modules with queued messages are resolved, the rest of the table is left as it is
+   const auto queuedModules = mNonWriterQueue.uniqueKeys();
+
+   for (const auto &queuedModule : queuedModules)
+      writeAndDequeueMessages(queuedModule);
+
+   updateCallSiteThreshold();
+}
+
+QVector<QLoggerWriter *> QLoggerManager::uniqueWriters() const
+{
+   QVector<QLoggerWriter *> writers;
+   QSet<QLoggerWriter *> seen;
+
+   for (const auto &destination : mModuleDest)
+   {
+      if (!seen.contains(destination.writer))
+      {
+         seen.insert(destination.writer);
+         writers.append(destination.writer);
+      }
    }
+
+   return writers;
 }
 
 void QLoggerManager::pause()
@@ -227,8 +943,9 @@ void QLoggerManager::pause()
    QMutexLocker lock(&mMutex);
 
    mIsStop = true;
+   mIsBuffering = mPauseBuffer && mPauseBuffer->isEnabled();
 
-   for (auto &logWriter : mModuleDest)
+   for (const auto logWriter : uniqueWriters())
       logWriter->stop(mIsStop);
 }
 
@@ -238,8 +955,45 @@ void QLoggerManager::resume()
 
    mIsStop = false;
 
-   for (auto &logWriter : mModuleDest)
+   for (const auto logWriter : uniqueWriters())
       logWriter->stop(mIsStop);
+
+   if (!mIsBuffering || mIsDraining)
+      return;
+
+   mIsDraining = true;
+
+   // The buffer is written from a pooled thread, so resume returns at once. The lock is released between batches,
+   // so the callers only wait for one batch, and the drain stops if the manager is paused again.
+   QThreadPool::globalInstance()->start([this]() {
+      forever
+      {
+         QMutexLocker drainLock(&mMutex);
+
+         if (mIsStop || drainPauseBuffer())
+         {
+            mIsDraining = false;
+            return;
+         }
+      }
+   });
+}
+
+void QLoggerManager::setPauseBuffer(qint64 memoryBytes, qint64 spillBytes)
+{
+   QMutexLocker lock(&mMutex);
+
+   if (!mPauseBuffer)
+      mPauseBuffer = new QLoggerPauseBuffer();
+
+   mPauseBuffer->setLimits(memoryBytes, spillBytes);
+}
+
+PauseStatistics QLoggerManager::getPauseStatistics() const
+{
+   QMutexLocker lock(&mMutex);
+
+   return mPauseBuffer ? mPauseBuffer->statistics() : PauseStatistics();
 }
 
 void QLoggerManager::overwriteLogMode(LogMode mode)
@@ -248,7 +1002,7 @@ void QLoggerManager::overwriteLogMode(LogMode mode)
 
    setDefaultMode(mode);
 
-   for (auto &logWriter : mModuleDest)
+   for (const auto logWriter : uniqueWriters())
       logWriter->setLogMode(mode);
 }
 
@@ -258,8 +1012,13 @@ void QLoggerManager::overwriteLogLevel(LogLevel level)
 
    setDefaultLevel(level);
 
-   for (auto &logWriter : mModuleDest)
+   for (const auto logWriter : uniqueWriters())
       logWriter->setLogLevel(level);
+
+   for (auto &destination : mModuleDest)
+      destination.level = level;
+
+   rebuildRoutes();
 }
 
 void QLoggerManager::overwriteMaxFileSize(int maxSize)
@@ -268,54 +1027,199 @@ void QLoggerManager::overwriteMaxFileSize(int maxSize)
 
    setDefaultMaxFileSize(maxSize);
 
-   for (auto &logWriter : mModuleDest)
+   for (const auto logWriter : uniqueWriters())
       logWriter->setMaxFileSize(maxSize);
 }
 
-QLoggerManager::~QLoggerManager()
+void QLoggerManager::overwriteMaxRotatedFiles(int maxRotatedFiles)
 {
-   QMutexLocker locker(&mMutex);
+   QMutexLocker lock(&mMutex);
+
+   setDefaultMaxRotatedFiles(maxRotatedFiles);
+
+   for (const auto logWriter : uniqueWriters())
+      logWriter->setMaxRotatedFiles(maxRotatedFiles);
+}
+
+void QLoggerManager::overwriteRotation(LogRotation rotation)
+{
+   QMutexLocker lock(&mMutex);
+
+   setDefaultRotation(rotation);
+
+   for (const auto logWriter : uniqueWriters())
+      logWriter->setRotation(rotation);
+}
+
+void QLoggerManager::overwriteIndexBlockSize(int blockSize)
+{
+   QMutexLocker lock(&mMutex);
 
-   for (const auto &dest : mModuleDest.toStdMap())
-      writeAndDequeueMessages(dest.first);
+   setDefaultIndexBlockSize(blockSize);
 
-   QVector<QString> oldFiles;
+   for (const auto logWriter : uniqueWriters())
+      logWriter->setIndexBlockSize(blockSize);
+}
+
+void QLoggerManager::overwriteBatchDelay(int microseconds)
+{
+   QMutexLocker lock(&mMutex);
+
+   setDefaultBatchDelay(microseconds);
+
+   for (const auto logWriter : uniqueWriters())
+      logWriter->setBatchDelay(microseconds);
+}
 
-   for (auto dest : std::as_const(mModuleDest))
+ShutdownReport QLoggerManager::shutdown(int timeout)
+{
+   // Qt may still print messages after the manager is gone, so they go back to the previous handler
+   uninstallQtMessageHandler();
+
+   // The last scope summaries and volume report are written before the destinations are closed. The reporters
+   // enqueue them with mMutex, so they are stopped before taking it.
    {
-      dest->closeDestination();
-      dest->wait();
+      QMutexLocker scopeLock(&mScopeMutex);
+
+      if (mScopeReporter)
+      {
+         mScopeReporter->closeReporter();
+         mScopeReporter->wait();
+      }
 
-      oldFiles.append(dest->getFileDestinationFolder());
+      if (mVolumeReporter)
+      {
+         mVolumeReporter->closeReporter();
+         mVolumeReporter->wait();
+      }
    }
 
-   for (auto dest : std::as_const(mModuleDest))
-      delete dest;
+   QMutexLocker locker(&mMutex);
+
+   const QDeadlineTimer deadline(timeout);
+   ShutdownReport report;
+   const auto writers = uniqueWriters();
+
+   // The messages kept while paused are written instead of being lost
+   if (mIsBuffering)
+   {
+      mIsStop = false;
+
+      for (const auto dest : writers)
+         dest->stop(mIsStop);
+
+      while (!drainPauseBuffer())
+         ;
+   }
+
+   const auto queuedModules = mNonWriterQueue.uniqueKeys();
+
+   for (const auto &module : queuedModules)
+      writeAndDequeueMessages(module);
+
+   // All the writers drain their queues at the same time
+   for (const auto dest : writers)
+      dest->closeDestination();
+
+   QStringList closedFolders;
+
+   for (const auto dest : writers)
+   {
+      if (dest->wait(deadline))
+      {
+         // Socket destinations don't have a folder
+         if (!dest->getFileDestinationFolder().isEmpty() && !closedFolders.contains(dest->getFileDestinationFolder()))
+            closedFolders.append(dest->getFileDestinationFolder());
+
+         delete dest;
+      }
+      else
+      {
+         //! @note The writer is still running, so it is deleted by the destructor once it finishes
+         report.pendingDestinations.append(dest->getFileDestination());
+         mPendingWriters.append(dest);
+      }
+   }
 
    mModuleDest.clear();
+   mFileWriters.clear();
+   mRoutes.reset();
 
-   if (!mNewLogsFolder.isEmpty() && mNewLogsFolder != mDefaultFileDestinationFolder)
    {
-      for (const auto &oldDestination : oldFiles)
+      QMutexLocker retentionLock(&mRetentionMutex);
+
+      for (auto retention : std::as_const(mRetention))
+         retention->closeRetention();
+
+      for (auto retention : std::as_const(mRetention))
       {
-         QDir dir(oldDestination);
+         if (retention->wait(deadline))
+            delete retention;
+         else
+            mPendingRetention.append(retention);
+      }
 
-         auto entryList = dir.entryList(QDir::Files | QDir::System | QDir::Hidden);
+      mRetention.clear();
+   }
 
-         for (const auto &filePath : std::as_const(entryList))
-         {
-            auto destination = mNewLogsFolder;
-            if (!destination.endsWith("/"))
-               destination.append("/");
-            destination.append(filePath.split("/").last());
+   if (!mNewLogsFolder.isEmpty() && mNewLogsFolder != mDefaultFileDestinationFolder)
+      report.notMovedFiles = moveLogs(closedFolders, deadline);
 
-            QDir().rename(oldDestination + "/" + filePath, destination);
+   return report;
+}
 
-            if (dir.isEmpty())
-               dir.removeRecursively();
-         }
+QStringList QLoggerManager::moveLogs(const QStringList &folders, const QDeadlineTimer &deadline) const
+{
+   QStringList notMoved;
+
+   auto destination = mNewLogsFolder;
+   if (!destination.endsWith("/"))
+      destination.append("/");
+
+   QDir destinationDir(destination);
+   destinationDir.mkpath(QStringLiteral("."));
+
+   for (const auto &folder : folders)
+   {
+      QDir dir(folder);
+
+      const auto entryList = dir.entryList(QDir::Files | QDir::System | QDir::Hidden);
+
+      for (const auto &fileName : entryList)
+      {
+         if (deadline.hasExpired() || !dir.rename(fileName, destination + fileName))
+            notMoved.append(dir.filePath(fileName));
       }
+
+      if (dir.isEmpty())
+         dir.removeRecursively();
    }
+
+   return notMoved;
+}
+
+QLoggerManager::~QLoggerManager()
+{
+   shutdown();
+
+   // What missed the deadline has already been reported, but it can't outlive the singletons it uses
+   for (const auto dest : std::as_const(mPendingWriters))
+   {
+      dest->wait();
+      delete dest;
+   }
+
+   for (const auto retention : std::as_const(mPendingRetention))
+   {
+      retention->wait();
+      delete retention;
+   }
+
+   qDeleteAll(mFlightRecorders);
+   delete mSharedRing;
+   delete mScopeReporter;
+   delete mVolumeReporter;
+   delete mPauseBuffer;
 }
 
 }
@@ -0,0 +1,67 @@
+#include "QLoggerBufferPool.h"
+
+namespace QLogger
+{
+
+static const int POOL_LIMIT = 4096;
+
+QLoggerBufferPool *QLoggerBufferPool::getInstance()
+{
+   static QLoggerBufferPool INSTANCE;
+
+   return &INSTANCE;
+}
+
+QString QLoggerBufferPool::acquire()
+{
+   QMutexLocker lock(&mMutex);
+
+   if (!mBuffers.isEmpty())
+      return mBuffers.takeLast();
+
+   QString buffer;
+   buffer.reserve(mMaxBufferSize);
+
+   return buffer;
+}
+
+void QLoggerBufferPool::release(QString &buffer)
+{
+   if (!buffer.isDetached())
+   {
+      buffer = QString();
+      return;
+   }
+
+   QMutexLocker lock(&mMutex);
+
+   // Buffers that had to grow well beyond the configured size are released
+   if (buffer.capacity() > 2 * mMaxBufferSize || mBuffers.count() >= POOL_LIMIT)
+   {
+      buffer = QString();
+      return;
+   }
+
+   // Keeps the capacity of the buffer
+   buffer.resize(0);
+
+   mBuffers.append(std::move(buffer));
+   buffer = QString();
+}
+
+void QLoggerBufferPool::setMaxBufferSize(int size)
+{
+   QMutexLocker lock(&mMutex);
+
+   mMaxBufferSize = size;
+   mBuffers.clear();
+}
+
+int QLoggerBufferPool::getMaxBufferSize() const
+{
+   QMutexLocker lock(&mMutex);
+
+   return mMaxBufferSize;
+}
+
+}
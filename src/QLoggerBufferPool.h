@@ -0,0 +1,78 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerBufferPool class recycles the buffers used to format the messages. The producers take a buffer
+ * from the pool to format a record and the writers give it back once it has been written, so in steady state
+ * logging a message doesn't allocate memory.
+ */
+class QLoggerBufferPool
+{
+public:
+   /**
+    * @brief Gets an instance to the QLoggerBufferPool.
+    * @return A pointer to the instance.
+    */
+   static QLoggerBufferPool *getInstance();
+
+   /**
+    * @brief acquire Takes an empty buffer from the pool. If the pool is empty, a new buffer is reserved.
+    * @return An empty buffer.
+    */
+   QString acquire();
+
+   /**
+    * @brief release Gives a buffer back to the pool. The buffer is only recycled if nobody else references it and
+    * it has not grown beyond twice the maximum buffer size.
+    * @param buffer The buffer to recycle. It is left empty.
+    */
+   void release(QString &buffer);
+
+   /**
+    * @brief setMaxBufferSize Sets the maximum size in characters of the recycled buffers. Messages longer than
+    * this still work but allocate their own memory.
+    * @param size The maximum size.
+    */
+   void setMaxBufferSize(int size);
+
+   /**
+    * @brief getMaxBufferSize Gets the maximum size in characters of the recycled buffers.
+    */
+   int getMaxBufferSize() const;
+
+private:
+   mutable QMutex mMutex;
+   QVector<QString> mBuffers;
+   int mMaxBufferSize = 512;
+
+   QLoggerBufferPool() = default;
+};
+
+}
@@ -0,0 +1,311 @@
+#include <QLoggerCallSite.h>
+
+#include <algorithm>
+
+namespace QLogger
+{
+
+namespace
+{
+
+/**
+ * @brief Number of owned call sites cached by every thread in siteFor.
+ */
+const int SITE_CACHE_SIZE = 64;
+
+/**
+ * @brief Converts a file glob to a regular expression where * and ? also match '/', so one * can cover several folders
+ * of the absolute paths of __FILE__. QRegularExpression::wildcardToRegularExpression treats the glob as a path and
+ * stops * at every separator.
+ */
+QRegularExpression globToRegularExpression(const QString &glob)
+{
+   QString pattern;
+   pattern.reserve(glob.size() * 2);
+
+   for (const auto character : glob)
+   {
+      if (character == QLatin1Char('*'))
+         pattern.append(QLatin1String(".*"));
+      else if (character == QLatin1Char('?'))
+         pattern.append(QLatin1Char('.'));
+      else
+         pattern.append(QRegularExpression::escape(QString(character)));
+   }
+
+   return QRegularExpression(QRegularExpression::anchoredPattern(pattern));
+}
+
+}
+
+CallSite::CallSite(const char *file, int line, const char *function, LogLevel level)
+   : CallSite(file, line, function, level, Owned())
+{
+   CallSiteRegistry::getInstance()->registerSite(this);
+   mIsRegistered = true;
+}
+
+CallSite::CallSite(const char *file, int line, const char *function, LogLevel level, Owned)
+   : mFile(file)
+   , mLine(line)
+   , mFunction(function)
+   , mLevel(level)
+   , mFunctionName(QString::fromUtf8(function))
+{
+   const auto filePath = QString::fromUtf8(file);
+   mFileName = filePath.mid(filePath.lastIndexOf('/') + 1);
+}
+
+CallSite::~CallSite()
+{
+   if (mIsRegistered)
+      CallSiteRegistry::getInstance()->unregisterSite(this);
+}
+
+CallSiteRegistry *CallSiteRegistry::getInstance()
+{
+   static CallSiteRegistry INSTANCE;
+
+   return &INSTANCE;
+}
+
+CallSiteRegistry::~CallSiteRegistry()
+{
+   for (const auto &owned : std::as_const(mOwnedSites))
+      delete owned.site;
+}
+
+int CallSiteRegistry::enable(const QString &fileGlob, int line)
+{
+   return addRule(fileGlob, line, CallSite::Override::Enabled);
+}
+
+int CallSiteRegistry::disable(const QString &fileGlob, int line)
+{
+   return addRule(fileGlob, line, CallSite::Override::Disabled);
+}
+
+void CallSiteRegistry::reset()
+{
+   QMutexLocker lock(&mMutex);
+
+   mRules.clear();
+
+   for (auto site : std::as_const(mSites))
+      applyRules(site);
+}
+
+void CallSiteRegistry::setThreshold(LogLevel level)
+{
+   QMutexLocker lock(&mMutex);
+
+   if (mThreshold == level)
+      return;
+
+   mThreshold = level;
+
+   for (auto site : std::as_const(mSites))
+      applyRules(site);
+}
+
+void CallSiteRegistry::setRecording(bool isRecording)
+{
+   QMutexLocker lock(&mMutex);
+
+   if (mIsRecording == isRecording)
+      return;
+
+   mIsRecording = isRecording;
+
+   for (auto site : std::as_const(mSites))
+      applyRules(site);
+}
+
+QVector<CallSiteInfo> CallSiteRegistry::callSites() const
+{
+   QMutexLocker lock(&mMutex);
+   QVector<CallSiteInfo> sites;
+   sites.reserve(mSites.count());
+
+   for (const auto site : mSites)
+   {
+      sites.append({ QString::fromUtf8(site->mFile), site->mLine, QString::fromUtf8(site->mFunction), site->mLevel,
+                     site->isEnabled(), site->messages(), site->characters() });
+   }
+
+   return sites;
+}
+
+QVector<CallSiteInfo> CallSiteRegistry::topSites(int count) const
+{
+   struct Volume
+   {
+      const CallSite *site;
+      quint64 messages;
+      quint64 characters;
+   };
+
+   QMutexLocker lock(&mMutex);
+
+   // The counters keep changing while sorting, so they are read once
+   QVector<Volume> volumes;
+   volumes.reserve(mSites.count());
+
+   for (const auto site : mSites)
+   {
+      if (const auto messages = site->messages())
+         volumes.append({ site, messages, site->characters() });
+   }
+
+   const auto top = qBound(0, count, static_cast<int>(volumes.count()));
+
+   std::partial_sort(volumes.begin(), volumes.begin() + top, volumes.end(), [](const Volume &a, const Volume &b) {
+      return a.characters != b.characters ? a.characters > b.characters : a.messages > b.messages;
+   });
+
+   QVector<CallSiteInfo> sites;
+   sites.reserve(top);
+
+   for (auto i = 0; i < top; ++i)
+   {
+      const auto &volume = volumes.at(i);
+      const auto site = volume.site;
+
+      sites.append({ QString::fromUtf8(site->mFile), site->mLine, QString::fromUtf8(site->mFunction), site->mLevel,
+                     site->isEnabled(), volume.messages, volume.characters });
+   }
+
+   return sites;
+}
+
+void CallSiteRegistry::resetVolume()
+{
+   QMutexLocker lock(&mMutex);
+
+   for (auto site : std::as_const(mSites))
+   {
+      site->mMessages.store(0, std::memory_order_relaxed);
+      site->mCharacters.store(0, std::memory_order_relaxed);
+   }
+}
+
+const CallSite *CallSiteRegistry::siteFor(const QString &file, int line, const QString &function, LogLevel level)
+{
+   struct CachedSite
+   {
+      QString file;
+      int line = -1;
+      LogLevel level = LogLevel::Trace;
+      const CallSite *site = nullptr;
+   };
+
+   // The owned sites live as long as the registry, so the cache never points to a deleted site
+   static thread_local CachedSite cache[SITE_CACHE_SIZE];
+
+   const auto slot = (static_cast<uint>(qHash(file)) ^ static_cast<uint>(line) * 31u ^ static_cast<uint>(level))
+       % SITE_CACHE_SIZE;
+   auto &cached = cache[slot];
+
+   if (cached.site && cached.line == line && cached.level == level && cached.file == file)
+      return cached.site;
+
+   const auto key = file + QLatin1Char(':') + QString::number(line) + QLatin1Char(':')
+       + QString::number(static_cast<int>(level));
+
+   QMutexLocker lock(&mMutex);
+
+   auto owned = mOwnedSites.find(key);
+
+   if (owned == mOwnedSites.end())
+   {
+      // The site points to the strings of the entry, which are implicitly shared and never modified
+      OwnedSite entry { file.toUtf8(), function.toUtf8(), nullptr };
+      entry.site = new CallSite(entry.file.constData(), line, entry.function.constData(), level, CallSite::Owned());
+
+      applyRules(entry.site);
+      mSites.append(entry.site);
+
+      owned = mOwnedSites.insert(key, entry);
+   }
+
+   cached = { file, line, level, owned->site };
+
+   return owned->site;
+}
+
+void CallSiteRegistry::registerSite(CallSite *site)
+{
+   QMutexLocker lock(&mMutex);
+
+   applyRules(site);
+
+   mSites.append(site);
+}
+
+void CallSiteRegistry::unregisterSite(CallSite *site)
+{
+   QMutexLocker lock(&mMutex);
+
+   mSites.removeOne(site);
+}
+
+int CallSiteRegistry::addRule(const QString &fileGlob, int line, CallSite::Override state)
+{
+   QMutexLocker lock(&mMutex);
+
+   Rule rule;
+   rule.fileRegExp = globToRegularExpression(fileGlob);
+   rule.line = line;
+   rule.state = state;
+
+   mRules.append(rule);
+
+   auto count = 0;
+
+   for (auto site : std::as_const(mSites))
+   {
+      if (matches(rule, site))
+      {
+         applyRules(site);
+         ++count;
+      }
+   }
+
+   return count;
+}
+
+bool CallSiteRegistry::matches(const Rule &rule, const CallSite *site)
+{
+   if (rule.line != -1 && rule.line != site->mLine)
+      return false;
+
+   const auto file = QString::fromUtf8(site->mFile);
+   const auto fileName = file.mid(file.lastIndexOf('/') + 1);
+
+   return rule.fileRegExp.match(file).hasMatch() || rule.fileRegExp.match(fileName).hasMatch();
+}
+
+void CallSiteRegistry::applyRules(CallSite *site) const
+{
+   auto state = CallSite::Override::Inherit;
+
+   // The last rule that matches wins
+   for (auto iter = mRules.crbegin(); iter != mRules.crend(); ++iter)
+   {
+      if (matches(*iter, site))
+      {
+         state = iter->state;
+         break;
+      }
+   }
+
+   // The call sites don't know their module, so the flight recorders enable the Trace and Debug sites of all of them
+   const auto enabled = state == CallSite::Override::Enabled
+       || (state == CallSite::Override::Inherit
+           && (site->mLevel >= mThreshold || (mIsRecording && site->mLevel <= LogLevel::Debug)));
+
+   site->mOverride.store(state, std::memory_order_relaxed);
+   site->mEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+}
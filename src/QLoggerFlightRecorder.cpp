@@ -0,0 +1,56 @@
+#include "QLoggerFlightRecorder.h"
+
+#include "QLoggerMemoryBudget.h"
+
+namespace QLogger
+{
+
+QLoggerFlightRecorder::QLoggerFlightRecorder(int capacity)
+   : mRecords(qMax(capacity, 1))
+{
+}
+
+QLoggerFlightRecorder::~QLoggerFlightRecorder()
+{
+   takeRecords();
+}
+
+void QLoggerFlightRecorder::record(const QLoggerRecord &record)
+{
+   const auto budget = QLoggerMemoryBudget::getInstance();
+
+   if (!budget->acquire(QLoggerMemoryBudget::messageCost(record.message), record.level))
+      return;
+
+   // The oldest record is replaced once the ring is full
+   if (mCount == mRecords.count())
+      budget->release(QLoggerMemoryBudget::messageCost(mRecords.at(mNext).message));
+
+   mRecords[mNext] = record;
+   mNext = (mNext + 1) % mRecords.count();
+   mCount = qMin(mCount + 1, mRecords.count());
+}
+
+QVector<QLoggerRecord> QLoggerFlightRecorder::takeRecords()
+{
+   QVector<QLoggerRecord> records;
+   records.reserve(mCount);
+
+   const auto budget = QLoggerMemoryBudget::getInstance();
+   const auto capacity = mRecords.count();
+   const auto first = (mNext - mCount + capacity) % capacity;
+
+   for (auto i = 0; i < mCount; ++i)
+   {
+      auto &slot = mRecords[(first + i) % capacity];
+      budget->release(QLoggerMemoryBudget::messageCost(slot.message));
+      records.append(slot);
+      slot = QLoggerRecord();
+   }
+
+   mCount = 0;
+
+   return records;
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include "QLoggerRecord.h"
+
+#include <QVector>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerFlightRecorder class keeps the last records of a module in a ring of fixed capacity. The records
+ * are stored raw, so recording one only copies the references to its strings. It is not thread safe: the
+ * QLoggerManager accesses it under its mutex.
+ */
+class QLoggerFlightRecorder
+{
+public:
+   /**
+    * @brief Constructor that reserves the ring.
+    * @param capacity The amount of records kept. Once full, the oldest record is replaced.
+    */
+   explicit QLoggerFlightRecorder(int capacity = 0);
+
+   /**
+    * @brief Destructor that gives the memory of the stored records back to the memory budget.
+    */
+   ~QLoggerFlightRecorder();
+
+   QLoggerFlightRecorder(const QLoggerFlightRecorder &) = delete;
+   QLoggerFlightRecorder &operator=(const QLoggerFlightRecorder &) = delete;
+
+   /**
+    * @brief record Stores a record in the ring. The record is accounted in the memory budget and it is not stored if
+    * it doesn't fit.
+    * @param record The record to store.
+    */
+   void record(const QLoggerRecord &record);
+
+   /**
+    * @brief takeRecords Gets the stored records and empties the ring. Their memory is given back to the budget, since
+    * the destinations account them again when they are queued.
+    * @return The records from the oldest to the newest.
+    */
+   QVector<QLoggerRecord> takeRecords();
+
+   /**
+    * @brief getCapacity Gets the amount of records that the ring can keep.
+    */
+   int getCapacity() const { return mRecords.count(); }
+
+   /**
+    * @brief getCount Gets the amount of records stored.
+    */
+   int getCount() const { return mCount; }
+
+private:
+   QVector<QLoggerRecord> mRecords;
+   int mNext = 0;
+   int mCount = 0;
+};
+
+}
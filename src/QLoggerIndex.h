@@ -0,0 +1,123 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerIndexEntry struct describes one block of a log file in its sidecar index. A block starts and
+ * ends at a line boundary.
+ */
+struct QLoggerIndexEntry
+{
+   qint64 offset = 0; //! @note Position of the block in the log file, in bytes
+   qint64 length = 0;
+   qint64 firstTimestamp = 0; //! @note Oldest message in the block, in milliseconds since epoch
+   qint64 lastTimestamp = 0; //! @note Newest message in the block, in milliseconds since epoch
+   quint32 levels = 0; //! @note Bit N is set if the block contains a message of LogLevel N
+};
+
+/**
+ * @brief The QLoggerIndex namespace contains the format of the sidecar index that a QLoggerWriter writes next to the
+ * log file. It is shared by the writer and the tools that read the index.
+ */
+namespace QLoggerIndex
+{
+static const quint32 MAGIC = 0x514C4958; //! @note "QLIX"
+static const quint32 VERSION = 1;
+
+/**
+ * @brief Gets the path of the index of a log file.
+ */
+inline QString indexFilePath(const QString &logFilePath)
+{
+   return logFilePath + QStringLiteral(".idx");
+}
+
+/**
+ * @brief Writes the header of a new index.
+ */
+inline void writeHeader(QDataStream &stream)
+{
+   stream << MAGIC << VERSION;
+}
+
+/**
+ * @brief Appends one block to the index.
+ */
+inline void writeEntry(QDataStream &stream, const QLoggerIndexEntry &entry)
+{
+   stream << entry.offset << entry.length << entry.firstTimestamp << entry.lastTimestamp << entry.levels;
+}
+
+/**
+ * @brief Reads all the blocks of an index. An incomplete last block, written while the log was being rotated or
+ * closed, is ignored.
+ * @param indexPath The path of the index.
+ * @param ok Set to false if the index doesn't exist or doesn't have a valid header.
+ * @return The blocks in the order they were written.
+ */
+inline QVector<QLoggerIndexEntry> readIndex(const QString &indexPath, bool *ok = nullptr)
+{
+   QVector<QLoggerIndexEntry> entries;
+   QFile file(indexPath);
+   quint32 magic = 0;
+   quint32 version = 0;
+
+   if (file.open(QIODevice::ReadOnly))
+   {
+      QDataStream stream(&file);
+      stream >> magic >> version;
+   }
+
+   const auto isValid = magic == MAGIC && version == VERSION;
+
+   if (ok)
+      *ok = isValid;
+
+   if (!isValid)
+      return entries;
+
+   QDataStream stream(&file);
+
+   while (!stream.atEnd())
+   {
+      QLoggerIndexEntry entry;
+      stream >> entry.offset >> entry.length >> entry.firstTimestamp >> entry.lastTimestamp >> entry.levels;
+
+      if (stream.status() != QDataStream::Ok)
+         break;
+
+      entries.append(entry);
+   }
+
+   return entries;
+}
+}
+
+}
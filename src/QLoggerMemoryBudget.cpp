@@ -0,0 +1,109 @@
+#include "QLoggerMemoryBudget.h"
+
+#include <QLogger.h>
+
+#include <limits>
+
+namespace QLogger
+{
+
+static const qint64 MESSAGE_OVERHEAD = 64;
+
+QLoggerMemoryBudget *QLoggerMemoryBudget::getInstance()
+{
+   static QLoggerMemoryBudget INSTANCE;
+
+   return &INSTANCE;
+}
+
+QLoggerMemoryBudget::QLoggerMemoryBudget()
+{
+   updateCeilings();
+}
+
+void QLoggerMemoryBudget::setLimit(qint64 bytes)
+{
+   QMutexLocker lock(&mMutex);
+
+   mLimit = qMax(0LL, bytes);
+
+   updateCeilings();
+}
+
+void QLoggerMemoryBudget::setReservation(LogLevel level, qint64 bytes)
+{
+   QMutexLocker lock(&mMutex);
+
+   mReservations[static_cast<int>(level)] = qMax(0LL, bytes);
+
+   updateCeilings();
+}
+
+bool QLoggerMemoryBudget::acquire(qint64 bytes, LogLevel level) noexcept
+{
+   const auto ceiling = mCeilings[static_cast<int>(level)].load(std::memory_order_relaxed);
+   auto used = mUsed.load(std::memory_order_relaxed);
+
+   do
+   {
+      if (used + bytes > ceiling)
+      {
+         mRejected.fetch_add(1, std::memory_order_relaxed);
+         return false;
+      }
+   } while (!mUsed.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+
+   const auto newUsed = used + bytes;
+   auto highWater = mHighWater.load(std::memory_order_relaxed);
+
+   while (newUsed > highWater && !mHighWater.compare_exchange_weak(highWater, newUsed, std::memory_order_relaxed))
+      ;
+
+   return true;
+}
+
+void QLoggerMemoryBudget::release(qint64 bytes) noexcept
+{
+   mUsed.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryStatistics QLoggerMemoryBudget::statistics() const
+{
+   MemoryStatistics statistics;
+
+   {
+      QMutexLocker lock(&mMutex);
+      statistics.limit = mLimit;
+   }
+
+   statistics.used = mUsed.load(std::memory_order_relaxed);
+   statistics.highWater = mHighWater.load(std::memory_order_relaxed);
+   statistics.dropped = mRejected.load(std::memory_order_relaxed);
+
+   return statistics;
+}
+
+qint64 QLoggerMemoryBudget::messageCost(const QString &text) noexcept
+{
+   // Literals don't own their data and report no capacity
+   const auto characters = qMax(text.size(), text.capacity());
+
+   return static_cast<qint64>(characters) * static_cast<qint64>(sizeof(QChar)) + MESSAGE_OVERHEAD;
+}
+
+void QLoggerMemoryBudget::updateCeilings()
+{
+   // A level can use the budget minus what is reserved for the levels above it
+   auto reservedAbove = 0LL;
+
+   for (auto level = LEVELS - 1; level >= 0; --level)
+   {
+      const auto ceiling = mLimit > 0 ? mLimit - reservedAbove : std::numeric_limits<qint64>::max();
+      mCeilings[level].store(ceiling, std::memory_order_relaxed);
+
+      const auto reservation = mReservations[level] < 0 ? mLimit / 8 : mReservations[level];
+      reservedAbove = qMin(mLimit, reservedAbove + reservation);
+   }
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerTypes.h>
+
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+
+namespace QLogger
+{
+
+struct MemoryStatistics;
+
+/**
+ * @brief The QLoggerMemoryBudget class accounts the memory of all the queued messages, no matter the writer or the
+ * queue that holds them: the writer queues, the messages of modules without destination, the flight recorders, the
+ * records of the pause buffer kept in memory and the output pending in the socket destinations. When a budget is set, a
+ * message is only queued if its level still has room: part of the budget can be reserved for the higher levels, so
+ * Error and Fatal messages are not dropped because of a flood of debug messages. Acquiring and releasing memory is
+ * lock-free.
+ */
+class QLoggerMemoryBudget
+{
+public:
+   /**
+    * @brief Gets an instance to the QLoggerMemoryBudget.
+    * @return A pointer to the instance.
+    */
+   static QLoggerMemoryBudget *getInstance();
+
+   /**
+    * @brief setLimit Sets the budget shared by all the queues.
+    * @param bytes The budget in bytes. If 0, there is no limit but the usage is still tracked.
+    */
+   void setLimit(qint64 bytes);
+
+   /**
+    * @brief setReservation Reserves part of the budget for the messages of the given level and above. Unless it is
+    * changed, an eighth of the budget is reserved for Error and Fatal.
+    * @param level The lowest level that can use the reserved memory.
+    * @param bytes The reserved bytes.
+    */
+   void setReservation(LogLevel level, qint64 bytes);
+
+   /**
+    * @brief acquire Accounts the memory of a message that is going to be queued.
+    * @param bytes The memory of the message.
+    * @param level The level of the message.
+    * @return True if the message fits in the budget, false if it has to be dropped.
+    */
+   bool acquire(qint64 bytes, LogLevel level) noexcept;
+
+   /**
+    * @brief release Gives back the memory of a message that has left the queue.
+    * @param bytes The memory of the message, the same amount that was acquired.
+    */
+   void release(qint64 bytes) noexcept;
+
+   /**
+    * @brief statistics Gets the budget, the current usage, the high-water mark and the dropped messages.
+    */
+   MemoryStatistics statistics() const;
+
+   /**
+    * @brief messageCost Gets the approximate memory of a queued message with the given text. A text formatted once
+    * and shared by several destinations is charged by each of them at the capacity of its pooled buffer, so the
+    * usage is an upper bound of the memory actually held.
+    */
+   static qint64 messageCost(const QString &text) noexcept;
+
+private:
+   static constexpr int LEVELS = static_cast<int>(LogLevel::Fatal) + 1;
+
+   mutable QMutex mMutex;
+   qint64 mLimit = 0;
+   qint64 mReservations[LEVELS] = { 0, 0, 0, 0, -1, 0 }; //! @note -1 uses the default reservation
+   std::atomic<qint64> mCeilings[LEVELS];
+   std::atomic<qint64> mUsed { 0 };
+   std::atomic<qint64> mHighWater { 0 };
+   std::atomic<quint64> mRejected { 0 };
+
+   QLoggerMemoryBudget();
+
+   void updateCeilings();
+};
+
+}
@@ -0,0 +1,241 @@
+#include "QLoggerPauseBuffer.h"
+
+#include "QLoggerMemoryBudget.h"
+
+#include <QLogger.h>
+
+#include <QDataStream>
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <utility>
+
+namespace QLogger
+{
+
+QLoggerPauseBuffer::~QLoggerPauseBuffer()
+{
+   QLoggerMemoryBudget::getInstance()->release(mMemoryUsed);
+
+   delete mSpill;
+}
+
+void QLoggerPauseBuffer::setLimits(qint64 memoryBytes, qint64 spillBytes)
+{
+   mMemoryLimit = qMax<qint64>(memoryBytes, 0);
+   mSpillLimit = qMax<qint64>(spillBytes, 0);
+}
+
+bool QLoggerPauseBuffer::push(const QLoggerRecord &record, bool force, bool priority)
+{
+   const auto cost = entryCost(record);
+
+   // Once the file has records, the new ones go after them so the order is kept. The records in memory are also
+   // accounted in the memory budget, the ones in the file are not.
+   if (mSpilledCount == 0 && mMemoryUsed + cost <= mMemoryLimit
+       && QLoggerMemoryBudget::getInstance()->acquire(cost, record.level))
+   {
+      // The taken records are only removed when the vector would grow
+      if (mHead > 0 && mRecords.count() == mRecords.capacity())
+      {
+         mRecords.remove(0, mHead);
+         mHead = 0;
+      }
+
+      mRecords.append({ record, force, priority });
+      mMemoryUsed += cost;
+
+      return true;
+   }
+
+   if (mSpillLimit > 0 && spill({ record, force, priority }))
+      return true;
+
+   ++mDropped;
+
+   return false;
+}
+
+QVector<QLoggerPauseBuffer::Entry> QLoggerPauseBuffer::takeBatch(int count)
+{
+   QVector<Entry> batch;
+   batch.reserve(count);
+
+   const auto budget = QLoggerMemoryBudget::getInstance();
+
+   while (batch.count() < count && mHead < mRecords.count())
+   {
+      auto &entry = mRecords[mHead++];
+      const auto cost = entryCost(entry.record);
+      mMemoryUsed -= cost;
+      budget->release(cost);
+      batch.append(std::move(entry));
+   }
+
+   if (mHead == mRecords.count())
+   {
+      mRecords.clear();
+      mHead = 0;
+   }
+
+   while (batch.count() < count && mSpilledCount > 0)
+      batch.append(unspill());
+
+   return batch;
+}
+
+void QLoggerPauseBuffer::releaseKeys()
+{
+   if (mSpilledCount == 0)
+      mKeys = QSet<QByteArray>();
+}
+
+PauseStatistics QLoggerPauseBuffer::statistics() const
+{
+   PauseStatistics statistics;
+   statistics.buffered = static_cast<quint64>(mRecords.count() - mHead) + mSpilledCount;
+   statistics.spilled = mSpilledCount;
+   statistics.dropped = mDropped;
+   statistics.memoryUsed = mMemoryUsed;
+   statistics.spillUsed = mSpill ? mSpill->size() - mReadPosition : 0;
+
+   return statistics;
+}
+
+bool QLoggerPauseBuffer::spill(const Entry &entry)
+{
+   if (!mSpill)
+   {
+      mSpill = new QTemporaryFile(QDir::tempPath() + QStringLiteral("/qlogger-pause-XXXXXX"));
+
+      if (!mSpill->open())
+      {
+         delete mSpill;
+         mSpill = nullptr;
+         return false;
+      }
+   }
+
+   const auto end = mSpill->size();
+
+   if (end >= mSpillLimit || !mSpill->seek(end))
+      return false;
+
+   const auto &record = entry.record;
+
+   QDataStream stream(mSpill);
+   stream << record.timestamp << record.threadId << record.module << static_cast<qint32>(record.level)
+          << record.function << record.fileName << static_cast<qint32>(record.line) << record.message
+          << record.sequence << entry.force << entry.priority << static_cast<qint32>(record.fields.size());
+
+   for (const auto &field : record.fields)
+   {
+      stream << QByteArray(field.key()) << static_cast<qint32>(field.type());
+
+      switch (field.type())
+      {
+         case Field::Type::Integer:
+            stream << field.toInteger();
+            break;
+         case Field::Type::Double:
+            stream << field.toDouble();
+            break;
+         case Field::Type::Bool:
+            stream << field.toBool();
+            break;
+         case Field::Type::String:
+            stream << field.toString();
+            break;
+      }
+   }
+
+   // A record that could not be written completely is removed
+   if (stream.status() != QDataStream::Ok)
+   {
+      mSpill->resize(end);
+      return false;
+   }
+
+   ++mSpilledCount;
+
+   return true;
+}
+
+QLoggerPauseBuffer::Entry QLoggerPauseBuffer::unspill()
+{
+   Entry entry;
+   auto &record = entry.record;
+   qint32 level = 0;
+   qint32 line = 0;
+   qint32 fieldCount = 0;
+
+   mSpill->seek(mReadPosition);
+
+   QDataStream stream(mSpill);
+   stream >> record.timestamp >> record.threadId >> record.module >> level >> record.function >> record.fileName
+       >> line >> record.message >> record.sequence >> entry.force >> entry.priority >> fieldCount;
+
+   record.level = static_cast<LogLevel>(level);
+   record.line = line;
+
+   for (auto i = 0; i < fieldCount && stream.status() == QDataStream::Ok; ++i)
+   {
+      QByteArray key;
+      qint32 type = 0;
+      stream >> key >> type;
+
+      const auto storedKey = mKeys.insert(key)->constData();
+
+      switch (static_cast<Field::Type>(type))
+      {
+         case Field::Type::Integer:
+         {
+            qint64 value = 0;
+            stream >> value;
+            record.fields.append({ storedKey, value });
+            break;
+         }
+         case Field::Type::Double:
+         {
+            double value = 0;
+            stream >> value;
+            record.fields.append({ storedKey, value });
+            break;
+         }
+         case Field::Type::Bool:
+         {
+            bool value = false;
+            stream >> value;
+            record.fields.append({ storedKey, value });
+            break;
+         }
+         case Field::Type::String:
+         {
+            QString value;
+            stream >> value;
+            record.fields.append({ storedKey, value });
+            break;
+         }
+      }
+   }
+
+   mReadPosition = mSpill->pos();
+
+   // The file is reused from the start once everything has been read, or dropped if it can't be read anymore
+   if (--mSpilledCount == 0 || stream.status() != QDataStream::Ok)
+   {
+      mDropped += mSpilledCount;
+      mSpilledCount = 0;
+      mReadPosition = 0;
+      mSpill->resize(0);
+   }
+
+   return entry;
+}
+
+qint64 QLoggerPauseBuffer::entryCost(const QLoggerRecord &record)
+{
+   return QLoggerMemoryBudget::messageCost(record.message) + static_cast<qint64>(sizeof(Entry));
+}
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include "QLoggerRecord.h"
+
+#include <QByteArray>
+#include <QSet>
+#include <QVector>
+
+class QTemporaryFile;
+
+namespace QLogger
+{
+
+struct PauseStatistics;
+
+/**
+ * @brief The QLoggerPauseBuffer class keeps the records logged while the QLoggerManager is paused, in order, so they
+ * can be written on resume. The records are kept raw in memory up to a limit and, if a spill limit is set, the rest
+ * are serialized to a temporary file. When both are full the new records are dropped. It is not thread safe: the
+ * QLoggerManager accesses it under its mutex.
+ */
+class QLoggerPauseBuffer
+{
+public:
+   /**
+    * @brief The Entry struct is a buffered record, whether it bypasses the level of the destinations and whether it
+    * goes to their priority lane.
+    */
+   struct Entry
+   {
+      QLoggerRecord record;
+      bool force = false;
+      bool priority = false;
+   };
+
+   QLoggerPauseBuffer() = default;
+   ~QLoggerPauseBuffer();
+
+   QLoggerPauseBuffer(const QLoggerPauseBuffer &) = delete;
+   QLoggerPauseBuffer &operator=(const QLoggerPauseBuffer &) = delete;
+
+   /**
+    * @brief setLimits Sets how much the buffer can hold. The records already buffered are kept.
+    * @param memoryBytes The memory for the records kept raw.
+    * @param spillBytes The size of the temporary file. If 0, nothing is spilled to disk.
+    */
+   void setLimits(qint64 memoryBytes, qint64 spillBytes);
+
+   /**
+    * @brief isEnabled Checks if the buffer can hold any record.
+    */
+   bool isEnabled() const { return mMemoryLimit > 0 || mSpillLimit > 0; }
+
+   /**
+    * @brief isEmpty Checks if there is any record left to take.
+    */
+   bool isEmpty() const { return mHead == mRecords.count() && mSpilledCount == 0; }
+
+   /**
+    * @brief push Stores a record after all the records already buffered.
+    * @param record The record.
+    * @param force Whether the record bypasses the level of the destinations.
+    * @param priority Whether the record goes to the priority lane of the destinations.
+    * @return False if there was no room left and the record has been dropped.
+    */
+   bool push(const QLoggerRecord &record, bool force, bool priority = false);
+
+   /**
+    * @brief takeBatch Takes the oldest records: first the ones in memory and then the ones in the file. The keys of
+    * the fields read from the file stay valid until releaseKeys is called.
+    * @param count The maximum amount of records.
+    */
+   QVector<Entry> takeBatch(int count);
+
+   /**
+    * @brief releaseKeys Frees the keys of the fields read from the file once all of its records have been taken.
+    * The records taken before must not be used anymore.
+    */
+   void releaseKeys();
+
+   /**
+    * @brief statistics Gets the records buffered and dropped and the memory and disk they use.
+    */
+   PauseStatistics statistics() const;
+
+private:
+   qint64 mMemoryLimit = 0;
+   qint64 mSpillLimit = 0;
+
+   QVector<Entry> mRecords;
+   int mHead = 0; //! @note The records before the head have already been taken
+   qint64 mMemoryUsed = 0;
+
+   /**
+    * @brief The file is only appended to while it has records, so all of them are newer than the ones in memory.
+    * It is truncated once it has been read completely.
+    */
+   QTemporaryFile *mSpill = nullptr;
+   qint64 mReadPosition = 0;
+   quint64 mSpilledCount = 0;
+
+   //! @note The keys of the fields read back from the file point here, since a Field doesn't own its key. They are
+   //! kept until the file has been replayed and its records written.
+   QSet<QByteArray> mKeys;
+
+   quint64 mDropped = 0;
+
+   bool spill(const Entry &entry);
+   Entry unspill();
+   static qint64 entryCost(const QLoggerRecord &record);
+};
+
+}
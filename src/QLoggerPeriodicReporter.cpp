@@ -0,0 +1,45 @@
+#include "QLoggerPeriodicReporter.h"
+
+namespace QLogger
+{
+
+QLoggerPeriodicReporter::QLoggerPeriodicReporter(int interval)
+   : mInterval(interval)
+{
+}
+
+void QLoggerPeriodicReporter::setInterval(int interval)
+{
+   QMutexLocker locker(&mMutex);
+   mInterval = interval;
+   mWakeUp.wakeAll();
+}
+
+void QLoggerPeriodicReporter::closeReporter()
+{
+   QMutexLocker locker(&mMutex);
+   mQuit = true;
+   mWakeUp.wakeAll();
+}
+
+void QLoggerPeriodicReporter::run()
+{
+   forever
+   {
+      {
+         QMutexLocker locker(&mMutex);
+
+         if (!mQuit)
+            mWakeUp.wait(&mMutex, static_cast<unsigned long>(qMax(1, mInterval)));
+
+         if (mQuit)
+            break;
+      }
+
+      report();
+   }
+
+   report();
+}
+
+}
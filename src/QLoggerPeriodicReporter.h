@@ -0,0 +1,77 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerPeriodicReporter class is a thread that calls report at a fixed interval and one last time when
+ * it is closed, so what has been measured since the previous report is not lost.
+ */
+class QLoggerPeriodicReporter : public QThread
+{
+   Q_OBJECT
+
+public:
+   /**
+    * @brief Constructor.
+    * @param interval The time between two reports in milliseconds.
+    */
+   explicit QLoggerPeriodicReporter(int interval);
+
+   /**
+    * @brief setInterval Sets the time between two reports.
+    * @param interval The time in milliseconds.
+    */
+   void setInterval(int interval);
+
+   /**
+    * @brief report Writes the report now.
+    */
+   virtual void report() = 0;
+
+   /**
+    * @brief closeReporter Stops the thread after writing the last report.
+    */
+   void closeReporter();
+
+   /**
+    * @brief run Overloaded method from QThread used to wait for the next report.
+    */
+   void run() override;
+
+protected:
+   //! @note Also guards the configuration of the subclasses
+   QMutex mMutex;
+
+private:
+   QWaitCondition mWakeUp;
+   int mInterval;
+   bool mQuit = false;
+};
+
+}
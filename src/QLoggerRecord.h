@@ -0,0 +1,50 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerField.h>
+#include <QLoggerTypes.h>
+
+#include <QString>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerRecord struct stores all the information captured when a message is logged. It is captured once
+ * and then formatted by every destination the module is routed to.
+ */
+struct QLoggerRecord
+{
+   qint64 timestamp = 0; //! @note Milliseconds since epoch
+   QString threadId;
+   QString module;
+   LogLevel level = LogLevel::Trace;
+   QString function;
+   QString fileName;
+   int line = -1;
+   QString message;
+   quint64 sequence = 0;
+   Fields fields;
+};
+
+}
@@ -0,0 +1,165 @@
+#include "QLoggerRetention.h"
+#include "QLoggerIndex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+
+namespace QLogger
+{
+
+/**
+ * @brief Interval to check the age of the files when there are no rotations.
+ */
+static const unsigned long AGE_CHECK_INTERVAL_MS = 60 * 60 * 1000;
+
+QLoggerRetention::QLoggerRetention(const QString &folder, const RetentionPolicy &policy)
+   : mFolder(folder)
+   , mPolicy(policy)
+{
+}
+
+void QLoggerRetention::setPolicy(const RetentionPolicy &policy)
+{
+   QMutexLocker locker(&mMutex);
+   mPolicy = policy;
+   mIsPolicyChanged = true;
+   mWakeUp.wakeAll();
+}
+
+void QLoggerRetention::addActiveFile(const QString &filePath)
+{
+   const auto path = QFileInfo(filePath).absoluteFilePath();
+
+   QMutexLocker locker(&mMutex);
+   mActiveFiles.insert(path);
+
+   // The file may have been tracked by the scan if the service started before the destination was added
+   mPendingActiveFiles.append(path);
+   mWakeUp.wakeAll();
+}
+
+void QLoggerRetention::fileRotated(const QString &filePath)
+{
+   QMutexLocker locker(&mMutex);
+   mPendingFiles.append(filePath);
+   mWakeUp.wakeAll();
+}
+
+void QLoggerRetention::closeRetention()
+{
+   QMutexLocker locker(&mMutex);
+   mQuit = true;
+   mWakeUp.wakeAll();
+}
+
+void QLoggerRetention::run()
+{
+   {
+      QMutexLocker locker(&mMutex);
+      const auto activeFiles = mActiveFiles;
+      locker.unlock();
+
+      scan(activeFiles);
+   }
+
+   forever
+   {
+      QVector<QString> pendingFiles;
+      QVector<QString> activeFiles;
+      RetentionPolicy policy;
+
+      {
+         QMutexLocker locker(&mMutex);
+
+         if (!mQuit && mPendingFiles.isEmpty() && mPendingActiveFiles.isEmpty() && !mIsPolicyChanged)
+            mWakeUp.wait(&mMutex, AGE_CHECK_INTERVAL_MS);
+
+         if (mQuit)
+            break;
+
+         std::swap(pendingFiles, mPendingFiles);
+         std::swap(activeFiles, mPendingActiveFiles);
+         mIsPolicyChanged = false;
+         policy = mPolicy;
+      }
+
+      for (const auto &path : std::as_const(activeFiles))
+         untrack(path);
+
+      for (const auto &filePath : std::as_const(pendingFiles))
+         track(filePath);
+
+      enforce(policy);
+   }
+}
+
+void QLoggerRetention::scan(const QSet<QString> &activeFiles)
+{
+   QDir dir(mFolder);
+   const auto entries = dir.entryInfoList(QDir::Files | QDir::Hidden | QDir::NoSymLinks, QDir::Time | QDir::Reversed);
+
+   for (const auto &entry : entries)
+   {
+      // The sidecar files are removed together with their log file
+      if (activeFiles.contains(entry.absoluteFilePath()) || entry.fileName().endsWith(QStringLiteral(".idx"))
+          || entry.fileName().endsWith(QStringLiteral(".next")))
+         continue;
+
+      mFiles.append({ entry.absoluteFilePath(), entry.size(), entry.lastModified() });
+      mTotalBytes += entry.size();
+   }
+}
+
+void QLoggerRetention::track(const QString &filePath)
+{
+   const QFileInfo info(filePath);
+   const auto path = info.absoluteFilePath();
+
+   // The file might have been overwritten by a rotation that reuses file names
+   untrack(path);
+
+   if (info.exists())
+   {
+      mFiles.append({ path, info.size(), info.lastModified() });
+      mTotalBytes += info.size();
+   }
+}
+
+void QLoggerRetention::untrack(const QString &path)
+{
+   const auto existing = std::find_if(mFiles.begin(), mFiles.end(),
+                                      [&path](const FileEntry &entry) { return entry.path == path; });
+
+   if (existing != mFiles.end())
+   {
+      mTotalBytes -= existing->size;
+      mFiles.erase(existing);
+   }
+}
+
+void QLoggerRetention::enforce(const RetentionPolicy &policy)
+{
+   const auto now = QDateTime::currentDateTime();
+
+   while (!mFiles.isEmpty())
+   {
+      const auto &oldest = mFiles.constFirst();
+      const auto tooOld = policy.maxAgeDays >= 0 && oldest.lastModified.daysTo(now) >= policy.maxAgeDays;
+      const auto tooMany = policy.maxFileCount >= 0 && mFiles.count() > policy.maxFileCount;
+      const auto tooBig = policy.maxTotalBytes >= 0 && mTotalBytes > policy.maxTotalBytes;
+
+      if (!tooOld && !tooMany && !tooBig)
+         break;
+
+      QFile::remove(oldest.path);
+      QFile::remove(QLoggerIndex::indexFilePath(oldest.path));
+
+      mTotalBytes -= oldest.size;
+      mFiles.removeFirst();
+   }
+}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerTypes.h>
+
+#include <QDateTime>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerRetention class enforces a RetentionPolicy on the rotated log files of a folder. The folder is
+ * scanned once when the service starts and then the writers notify every rotation, so the files are tracked in
+ * memory without scanning the folder again. The files are deleted from a low priority thread, never from the
+ * writer threads.
+ */
+class QLoggerRetention : public QThread
+{
+   Q_OBJECT
+
+public:
+   /**
+    * @brief Constructor that configures the service for a folder.
+    * @param folder The folder that stores the log files.
+    * @param policy The limits to apply.
+    */
+   QLoggerRetention(const QString &folder, const RetentionPolicy &policy);
+
+   /**
+    * @brief setPolicy Changes the limits applied to the folder.
+    * @param policy The new limits.
+    */
+   void setPolicy(const RetentionPolicy &policy);
+
+   /**
+    * @brief addActiveFile Protects a file that is being written by a destination. Active files are never deleted, even
+    * if they were found in the folder when the service started.
+    * @param filePath The complete path of the file.
+    */
+   void addActiveFile(const QString &filePath);
+
+   /**
+    * @brief fileRotated Notifies that a log file has been rotated. It is called from the writer threads and only
+    * enqueues the notification.
+    * @param filePath The complete path of the rotated file.
+    */
+   void fileRotated(const QString &filePath);
+
+   /**
+    * @brief closeRetention Stops the service.
+    */
+   void closeRetention();
+
+   /**
+    * @brief run Overloaded method from QThread used to wait for new rotations.
+    */
+   void run() override;
+
+private:
+   struct FileEntry
+   {
+      QString path;
+      qint64 size = 0;
+      QDateTime lastModified;
+   };
+
+   QString mFolder;
+   RetentionPolicy mPolicy;
+   QSet<QString> mActiveFiles;
+   QVector<QString> mPendingFiles;
+   QVector<QString> mPendingActiveFiles;
+   bool mIsPolicyChanged = false;
+   bool mQuit = false;
+   QMutex mMutex;
+   QWaitCondition mWakeUp;
+
+   //! @note Only accessed from the retention thread
+   QVector<FileEntry> mFiles;
+   qint64 mTotalBytes = 0;
+
+   /**
+    * @brief Lists the folder once and tracks the files sorted from the oldest to the newest.
+    */
+   void scan(const QSet<QString> &activeFiles);
+
+   /**
+    * @brief Tracks a file that has just been rotated.
+    */
+   void track(const QString &filePath);
+
+   /**
+    * @brief Stops tracking a file, so it is not deleted nor counted in the limits.
+    */
+   void untrack(const QString &path);
+
+   /**
+    * @brief Deletes the oldest files until the policy is fulfilled.
+    */
+   void enforce(const RetentionPolicy &policy);
+};
+
+}
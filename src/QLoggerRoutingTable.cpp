@@ -0,0 +1,72 @@
+#include "QLoggerRoutingTable.h"
+
+namespace QLogger
+{
+
+QLoggerRoutingTable::QLoggerRoutingTable(const QMultiMap<QString, QLoggerDestination> &destinations)
+{
+   for (auto iter = destinations.cbegin(); iter != destinations.cend(); ++iter)
+      addDestination(iter.key(), iter.value());
+}
+
+void QLoggerRoutingTable::addDestination(const QString &pattern, const QLoggerDestination &destination)
+{
+   Route *route = nullptr;
+
+   if (pattern == QStringLiteral("*"))
+      route = &mPrefixes[QString()];
+   else if (isWildcard(pattern))
+      route = &mPrefixes[pattern.left(pattern.size() - 2)];
+   else
+      route = &mExact[pattern];
+
+   route->destinations.append(destination);
+   route->level = qMin(route->level, destination.level);
+   mLowestLevel = qMin(mLowestLevel, destination.level);
+
+   // A new prefix can be more specific than the one a module was resolved to. Exact modules are looked up first, so
+   // they don't invalidate anything.
+   if (isWildcard(pattern))
+      mResolved.clear();
+}
+
+QLoggerRoutingTable::Route QLoggerRoutingTable::route(const QString &module) const
+{
+   const auto exact = mExact.constFind(module);
+
+   if (exact != mExact.cend())
+      return exact.value();
+
+   if (mPrefixes.isEmpty())
+      return Route();
+
+   const auto resolved = mResolved.constFind(module);
+
+   if (resolved != mResolved.cend())
+      return resolved.value();
+
+   auto route = mPrefixes.value(QString());
+
+   // Walks up the hierarchy: net.http.client -> net.http -> net -> *
+   for (auto dot = module.lastIndexOf('.'); dot > 0; dot = module.lastIndexOf('.', dot - 1))
+   {
+      const auto prefix = mPrefixes.constFind(module.left(dot));
+
+      if (prefix != mPrefixes.cend())
+      {
+         route = prefix.value();
+         break;
+      }
+   }
+
+   mResolved.insert(module, route);
+
+   return route;
+}
+
+bool QLoggerRoutingTable::isWildcard(const QString &pattern)
+{
+   return pattern == QStringLiteral("*") || pattern.endsWith(QStringLiteral(".*"));
+}
+
+}
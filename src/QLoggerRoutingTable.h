@@ -0,0 +1,105 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLogger.h>
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerRoutingTable class indexes the destinations configured in the QLoggerManager. Modules are
+ * dotted hierarchical names ("net.http.client") and destinations can be registered for an exact module, for all the
+ * descendants of a module ("net.*") or for all the modules ("*"). The most specific rule wins.
+ *
+ * New destinations are added in place, so registering N destinations costs O(N), and the table is only rebuilt when
+ * the levels of the destinations change. Resolving a module costs one hash lookup per level of the module hierarchy
+ * no matter how many rules are configured.
+ */
+class QLoggerRoutingTable
+{
+public:
+   /**
+    * @brief The Route struct stores the destinations of a module and the lowest level any of them accepts.
+    */
+   struct Route
+   {
+      QVector<QLoggerDestination> destinations;
+      LogLevel level = LogLevel::Fatal;
+   };
+
+   QLoggerRoutingTable() = default;
+
+   /**
+    * @brief Builds the routing table from the module patterns and their destinations.
+    * @param destinations Map of module patterns and the destinations assigned to them.
+    */
+   explicit QLoggerRoutingTable(const QMultiMap<QString, QLoggerDestination> &destinations);
+
+   /**
+    * @brief addDestination Adds a destination for a module pattern. Only the modules resolved through a prefix are
+    * resolved again, and only when they are looked up.
+    * @param pattern The module pattern.
+    * @param destination The writer and the level of the module pattern.
+    */
+   void addDestination(const QString &pattern, const QLoggerDestination &destination);
+
+   /**
+    * @brief route Resolves the destinations of a module.
+    * @param module The module name.
+    * @return The route. If no rule matches, the route has no destinations.
+    */
+   Route route(const QString &module) const;
+
+   /**
+    * @brief hasCatchAll Checks if there is a destination for all the modules ("*"), so every module has a route.
+    */
+   bool hasCatchAll() const { return mPrefixes.contains(QString()); }
+
+   /**
+    * @brief lowestLevel Gets the lowest level that any destination accepts, or Fatal if there is none.
+    */
+   LogLevel lowestLevel() const { return mLowestLevel; }
+
+   /**
+    * @brief isWildcard Checks if the module pattern matches more than one module.
+    */
+   static bool isWildcard(const QString &pattern);
+
+private:
+   QHash<QString, Route> mExact;
+   QHash<QString, Route> mPrefixes;
+   LogLevel mLowestLevel = LogLevel::Fatal;
+
+   /**
+    * @brief Modules resolved through a prefix, cached so walking up the hierarchy only happens once per module.
+    * @note The QLoggerManager only calls route while holding its mutex.
+    */
+   mutable QHash<QString, Route> mResolved;
+};
+
+}
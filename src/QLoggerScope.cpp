@@ -0,0 +1,21 @@
+#include <QLoggerScope.h>
+
+#include <QLogger.h>
+
+namespace QLogger
+{
+
+ScopeSite::ScopeSite(const char *file, int line, const char *function, const QString &module, const QString &name)
+   : mCallSite(file, line, function, LogLevel::Info)
+   , mModule(module)
+   , mName(name)
+{
+   QLoggerManager::getInstance()->registerScopeSite(this);
+}
+
+ScopeSite::~ScopeSite()
+{
+   QLoggerManager::getInstance()->unregisterScopeSite(this);
+}
+
+}
@@ -0,0 +1,54 @@
+#include "QLoggerScopeReporter.h"
+
+#include <QLogger.h>
+
+namespace QLogger
+{
+
+QLoggerScopeReporter::QLoggerScopeReporter(int interval)
+   : QLoggerPeriodicReporter(interval)
+{
+}
+
+void QLoggerScopeReporter::addSite(ScopeSite *site)
+{
+   QMutexLocker locker(&mSitesMutex);
+   mSites.append(site);
+}
+
+void QLoggerScopeReporter::removeSite(ScopeSite *site)
+{
+   QMutexLocker locker(&mSitesMutex);
+   mSites.removeOne(site);
+}
+
+void QLoggerScopeReporter::report()
+{
+   QMutexLocker locker(&mSitesMutex);
+
+   const auto manager = QLoggerManager::getInstance();
+
+   for (const auto site : std::as_const(mSites))
+   {
+      const auto snapshot = site->histogram().takeSnapshot();
+
+      if (snapshot.count == 0)
+         continue;
+
+      const auto p50 = snapshot.percentile(0.5) / 1000.0;
+      const auto p99 = snapshot.percentile(0.99) / 1000.0;
+      const auto max = snapshot.max / 1000.0;
+      const auto mean = static_cast<double>(snapshot.sum) / snapshot.count / 1000.0;
+
+      // The numbers go in the fields, so the text layout shows them as key=value pairs and the JSON one as numbers
+      manager->enqueueMessage(site->callSite(), site->module(), QStringLiteral("Scope summary"),
+                              { { "scope", site->name() },
+                                { "count", snapshot.count },
+                                { "p50_us", p50 },
+                                { "p99_us", p99 },
+                                { "max_us", max },
+                                { "mean_us", mean } });
+   }
+}
+
+}
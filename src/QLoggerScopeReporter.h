@@ -0,0 +1,64 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include "QLoggerPeriodicReporter.h"
+
+#include <QMutex>
+#include <QVector>
+
+namespace QLogger
+{
+
+class ScopeSite;
+
+/**
+ * @brief The QLoggerScopeReporter class periodically writes a summary of the histogram of every registered
+ * ScopeSite to the destinations of its module. The summary is only written for the sites that have been measured
+ * since the previous one.
+ */
+class QLoggerScopeReporter : public QLoggerPeriodicReporter
+{
+   Q_OBJECT
+
+public:
+   /**
+    * @brief Constructor.
+    * @param interval The time between two summaries in milliseconds.
+    */
+   explicit QLoggerScopeReporter(int interval);
+
+   void addSite(ScopeSite *site);
+   void removeSite(ScopeSite *site);
+
+   /**
+    * @brief report Writes the summaries now.
+    */
+   void report() override;
+
+private:
+   //! @note Held while reporting, so a site is never destroyed while its summary is written
+   QMutex mSitesMutex;
+   QVector<ScopeSite *> mSites;
+};
+
+}
@@ -0,0 +1,352 @@
+#include "QLoggerSharedRing.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QtMath>
+
+#include <cstring>
+#include <new>
+
+namespace QLogger
+{
+
+/**
+ * @brief Identifies the layout of the ring so processes built from different versions don't corrupt each other.
+ */
+static const quint32 RING_MAGIC = 0x514C5352; // "QLSR"
+static const quint32 RING_VERSION = 2;
+
+/**
+ * @brief Time that the collector waits for a slot that a producer reserved but never finished. After that, the slot
+ * is skipped.
+ */
+static const qint64 STALL_TIMEOUT_MS = 1000;
+
+/**
+ * @brief Time that the collector waits, once it comes back to a skipped slot on the next lap, before it considers
+ * the producer that was writing it dead and reuses the slot.
+ */
+static const qint64 REAP_TIMEOUT_MS = 30000;
+
+/**
+ * @brief States stored in the high bits of the sequence of a slot, next to the position that owns it.
+ */
+static const quint64 SLOT_WRITING = Q_UINT64_C(1) << 63;
+static const quint64 SLOT_SKIPPED = Q_UINT64_C(1) << 62;
+static const quint64 SLOT_STATE_MASK = SLOT_WRITING | SLOT_SKIPPED;
+
+static_assert(sizeof(std::atomic<quint64>) == sizeof(quint64), "The ring needs address-free 64-bit atomics");
+
+struct QLoggerSharedRing::Header
+{
+   quint32 magic;
+   quint32 version;
+   quint32 slotCount;
+   quint32 slotSize;
+   alignas(64) std::atomic<quint64> enqueuePosition;
+   alignas(64) std::atomic<quint64> droppedCount;
+   alignas(64) quint64 dequeuePosition;
+};
+
+struct QLoggerSharedRing::Slot
+{
+   std::atomic<quint64> sequence;
+   qint64 timestamp;
+   qint64 processId;
+   quint64 recordSequence;
+   qint32 level;
+   qint32 line;
+   quint16 moduleLength;
+   quint16 threadIdLength;
+   quint16 functionLength;
+   quint16 fileNameLength;
+   quint16 messageLength;
+   quint16 reserved;
+
+   static int capacity() { return static_cast<int>((SLOT_SIZE - sizeof(Slot)) / sizeof(QChar)); }
+   QChar *text() { return reinterpret_cast<QChar *>(this + 1); }
+};
+
+namespace
+{
+/**
+ * @brief Copies as much of the text as fits in the slot.
+ * @return The amount of characters copied.
+ */
+quint16 copyText(const QString &text, QChar *destination, int &available)
+{
+   const auto length = qMin(text.size(), available);
+
+   std::memcpy(destination, text.constData(), length * sizeof(QChar));
+   available -= length;
+
+   return static_cast<quint16>(length);
+}
+}
+
+QLoggerSharedRing::QLoggerSharedRing(const QString &key)
+   : mMemory(key)
+{
+}
+
+QLoggerSharedRing::~QLoggerSharedRing() = default;
+
+bool QLoggerSharedRing::create(int slotCount)
+{
+   if (!std::atomic<quint64>().is_lock_free())
+      return false;
+
+   const auto count = qNextPowerOfTwo(static_cast<quint32>(qMax(slotCount, 2)));
+   const auto size = headerSize() + static_cast<int>(count) * SLOT_SIZE;
+
+   if (!mMemory.create(size))
+   {
+      // The memory of a collector that crashed is left behind on some platforms. Attaching and detaching the last
+      // reference releases it.
+      if (mMemory.error() != QSharedMemory::AlreadyExists || !mMemory.attach())
+         return false;
+
+      mMemory.detach();
+
+      if (!mMemory.create(size))
+         return false;
+   }
+
+   mMemory.lock();
+
+   const auto data = static_cast<char *>(mMemory.data());
+
+   mHeader = new (data) Header;
+   mHeader->slotCount = count;
+   mHeader->slotSize = SLOT_SIZE;
+   new (&mHeader->enqueuePosition) std::atomic<quint64>(0);
+   new (&mHeader->droppedCount) std::atomic<quint64>(0);
+   mHeader->dequeuePosition = 0;
+   mSlots = data + headerSize();
+
+   for (quint32 i = 0; i < count; ++i)
+      new (&slot(i)->sequence) std::atomic<quint64>(i);
+
+   mHeader->version = RING_VERSION;
+   mHeader->magic = RING_MAGIC;
+
+   mMemory.unlock();
+
+   return true;
+}
+
+bool QLoggerSharedRing::attach()
+{
+   if (!std::atomic<quint64>().is_lock_free() || !mMemory.attach())
+      return false;
+
+   mMemory.lock();
+
+   const auto data = static_cast<char *>(mMemory.data());
+   const auto header = reinterpret_cast<Header *>(data);
+   const auto isValid = mMemory.size() >= headerSize() && header->magic == RING_MAGIC
+       && header->version == RING_VERSION && header->slotSize == static_cast<quint32>(SLOT_SIZE);
+
+   mMemory.unlock();
+
+   if (!isValid)
+   {
+      mMemory.detach();
+      return false;
+   }
+
+   mHeader = header;
+   mSlots = data + headerSize();
+
+   return true;
+}
+
+bool QLoggerSharedRing::push(const QLoggerRecord &record)
+{
+   quint64 position = 0;
+
+   return reserve(position) && publish(position, record);
+}
+
+bool QLoggerSharedRing::reserve(quint64 &position)
+{
+   if (!mHeader)
+      return false;
+
+   position = mHeader->enqueuePosition.load(std::memory_order_relaxed);
+
+   forever
+   {
+      const auto sequence = slot(position)->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<qint64>((sequence & ~SLOT_STATE_MASK) - position);
+
+      // A slot being written for this position has already been taken by another producer
+      if ((sequence & SLOT_STATE_MASK) != 0 && difference == 0)
+         difference = 1;
+
+      if (difference == 0)
+      {
+         if (mHeader->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            return true;
+      }
+      else if (difference < 0)
+      {
+         mHeader->droppedCount.fetch_add(1, std::memory_order_relaxed);
+         return false;
+      }
+      else
+         position = mHeader->enqueuePosition.load(std::memory_order_relaxed);
+   }
+}
+
+bool QLoggerSharedRing::publish(quint64 position, const QLoggerRecord &record)
+{
+   if (!mHeader)
+      return false;
+
+   const auto target = slot(position);
+
+   // The collector may have skipped the slot while this producer was stalled, and then it may belong to another one
+   auto expected = position;
+
+   if (!target->sequence.compare_exchange_strong(expected, position | SLOT_WRITING, std::memory_order_acquire))
+   {
+      mHeader->droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   auto available = Slot::capacity();
+   auto text = target->text();
+
+   target->timestamp = record.timestamp;
+   target->processId = QCoreApplication::applicationPid();
+   target->recordSequence = record.sequence;
+   target->level = static_cast<qint32>(record.level);
+   target->line = record.line;
+   target->moduleLength = copyText(record.module, text, available);
+   text += target->moduleLength;
+   target->threadIdLength = copyText(record.threadId, text, available);
+   text += target->threadIdLength;
+   target->functionLength = copyText(record.function, text, available);
+   text += target->functionLength;
+   target->fileNameLength = copyText(record.fileName, text, available);
+   text += target->fileNameLength;
+   target->messageLength = copyText(record.message, text, available);
+
+   expected = position | SLOT_WRITING;
+
+   if (!target->sequence.compare_exchange_strong(expected, position + 1, std::memory_order_release))
+   {
+      // The collector skipped the slot while it was written. Nobody else can use it until it is given to the next lap.
+      if (expected == (position | SLOT_SKIPPED))
+         target->sequence.compare_exchange_strong(expected, position + mHeader->slotCount, std::memory_order_release);
+
+      mHeader->droppedCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   return true;
+}
+
+bool QLoggerSharedRing::pop(QLoggerRecord &record)
+{
+   if (!mHeader)
+      return false;
+
+   const auto position = mHeader->dequeuePosition;
+   const auto target = slot(position);
+   auto sequence = target->sequence.load(std::memory_order_acquire);
+
+   if (sequence != position + 1)
+   {
+      const auto enqueuePosition = mHeader->enqueuePosition.load(std::memory_order_relaxed);
+      const auto isReserved = sequence == position && enqueuePosition > position;
+      const auto isWriting = sequence == (position | SLOT_WRITING);
+      const auto isSkipped
+          = position >= mHeader->slotCount && sequence == ((position - mHeader->slotCount) | SLOT_SKIPPED);
+
+      if (!isReserved && !isWriting && !isSkipped)
+      {
+         mStalledSince = -1;
+         return false;
+      }
+
+      // The time is counted from the last change of the slot
+      const auto now = QDateTime::currentMSecsSinceEpoch();
+
+      if (mStalledSince < 0 || sequence != mStalledSequence)
+      {
+         mStalledSince = now;
+         mStalledSequence = sequence;
+      }
+
+      const auto stalledFor = now - mStalledSince;
+
+      if (isReserved && stalledFor > STALL_TIMEOUT_MS)
+      {
+         // The producer didn't start copying, so the slot can go to the next lap: its producer won't be able to mark it
+         if (target->sequence.compare_exchange_strong(sequence, position + mHeader->slotCount))
+            mHeader->dequeuePosition = position + 1;
+
+         mStalledSince = -1;
+      }
+      else if (isWriting && stalledFor > STALL_TIMEOUT_MS)
+      {
+         // The producer is copying, so the slot stays blocked until it finishes and gives it to the next lap
+         if (target->sequence.compare_exchange_strong(sequence, position | SLOT_SKIPPED))
+            mHeader->dequeuePosition = position + 1;
+
+         mStalledSince = -1;
+      }
+      else if (isSkipped && stalledFor > REAP_TIMEOUT_MS)
+      {
+         // The producer that was copying a lap ago never finished, so it is considered dead
+         target->sequence.compare_exchange_strong(sequence, position);
+         mStalledSince = -1;
+      }
+
+      return false;
+   }
+
+   mStalledSince = -1;
+
+   auto text = target->text();
+
+   record.timestamp = target->timestamp;
+   record.sequence = target->recordSequence;
+   record.level = static_cast<LogLevel>(target->level);
+   record.line = target->line;
+   record.module = QString(text, target->moduleLength);
+   text += target->moduleLength;
+   record.threadId
+       = QString::number(target->processId) + QLatin1Char(':') + QString(text, target->threadIdLength);
+   text += target->threadIdLength;
+   record.function = QString(text, target->functionLength);
+   text += target->functionLength;
+   record.fileName = QString(text, target->fileNameLength);
+   text += target->fileNameLength;
+   record.message = QString(text, target->messageLength);
+
+   target->sequence.store(position + mHeader->slotCount, std::memory_order_release);
+   mHeader->dequeuePosition = position + 1;
+
+   return true;
+}
+
+quint64 QLoggerSharedRing::getDroppedCount() const
+{
+   return mHeader ? mHeader->droppedCount.load(std::memory_order_relaxed) : 0;
+}
+
+int QLoggerSharedRing::headerSize()
+{
+   // The slots start in their own cache line
+   return (static_cast<int>(sizeof(Header)) + 63) / 64 * 64;
+}
+
+QLoggerSharedRing::Slot *QLoggerSharedRing::slot(quint64 position) const
+{
+   return reinterpret_cast<Slot *>(mSlots + (position & (mHeader->slotCount - 1)) * SLOT_SIZE);
+}
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include "QLoggerRecord.h"
+
+#include <QSharedMemory>
+#include <QString>
+
+#include <atomic>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerSharedRing class is a bounded queue of records in shared memory. Several processes push records
+ * and a single collector process pops them (see tools/qlogger-collector). Every slot has a sequence number that
+ * tells if it is free or written, so the producers only use atomic operations and never wait: if the ring is full,
+ * the record is dropped and counted.
+ *
+ * A producer marks the slot while it copies the record. If a producer stalls, the collector skips its slot after a
+ * second: a slot that was not being written is given to the next lap at once, and the producer drops its record
+ * when it resumes. A slot that was being written is only reused once its producer finishes, or after a long timeout
+ * if the producer is dead, so a slow producer never writes into a slot that another producer owns.
+ */
+class QLoggerSharedRing
+{
+public:
+   /**
+    * @brief The size of a slot in bytes. The strings of a record are truncated to fit in one slot.
+    */
+   static const int SLOT_SIZE = 1024;
+
+   /**
+    * @brief Constructor that sets the key of the shared memory.
+    * @param key The key shared by the producers and the collector.
+    */
+   explicit QLoggerSharedRing(const QString &key);
+
+   /**
+    * @brief Destructor that detaches from the shared memory.
+    */
+   ~QLoggerSharedRing();
+
+   QLoggerSharedRing(const QLoggerSharedRing &) = delete;
+   QLoggerSharedRing &operator=(const QLoggerSharedRing &) = delete;
+
+   /**
+    * @brief create Creates the ring. It is called by the collector.
+    * @param slotCount The amount of slots. It is rounded up to a power of two.
+    * @return True if the ring was created, otherwise false.
+    */
+   bool create(int slotCount);
+
+   /**
+    * @brief attach Attaches to the ring created by the collector. It is called by the producers.
+    * @return True if the ring exists and has a compatible layout, otherwise false.
+    */
+   bool attach();
+
+   /**
+    * @brief push Copies a record to the ring. It never blocks.
+    * @param record The record to copy.
+    * @return False if the ring is full and the record has been dropped.
+    */
+   bool push(const QLoggerRecord &record);
+
+   /**
+    * @brief reserve Reserves the next slot. It is the first step of push.
+    * @param position The position of the reserved slot.
+    * @return False if the ring is full and the record has to be dropped.
+    */
+   bool reserve(quint64 &position);
+
+   /**
+    * @brief publish Copies a record to a reserved slot and makes it available to the collector. It is the second step
+    * of push.
+    * @param position The position returned by reserve.
+    * @param record The record to copy.
+    * @return False if the collector skipped the slot because the producer stalled, so the record has been dropped.
+    */
+   bool publish(quint64 position, const QLoggerRecord &record);
+
+   /**
+    * @brief pop Takes the oldest record from the ring. Only one process can pop.
+    * @param record The record taken. The thread id is prefixed with the process id.
+    * @return False if there are no records available.
+    */
+   bool pop(QLoggerRecord &record);
+
+   /**
+    * @brief getDroppedCount Gets the amount of records dropped because the ring was full.
+    */
+   quint64 getDroppedCount() const;
+
+   /**
+    * @brief getErrorString Gets the description of the last error of the shared memory.
+    */
+   QString getErrorString() const { return mMemory.errorString(); }
+
+private:
+   struct Header;
+   struct Slot;
+
+   QSharedMemory mMemory;
+   Header *mHeader = nullptr;
+   char *mSlots = nullptr;
+   qint64 mStalledSince = -1;
+   quint64 mStalledSequence = 0;
+
+   static int headerSize();
+   Slot *slot(quint64 position) const;
+};
+
+}
@@ -0,0 +1,337 @@
+#include "QLoggerSocketWriter.h"
+
+#include "QLoggerMemoryBudget.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QSysInfo>
+#include <QtEndian>
+
+#include <climits>
+
+#if defined(Q_OS_UNIX)
+#   include <arpa/inet.h>
+#   include <fcntl.h>
+#   include <netinet/in.h>
+#   include <poll.h>
+#   include <sys/socket.h>
+#   include <sys/un.h>
+#   include <unistd.h>
+
+#   include <cerrno>
+#   include <cstring>
+#endif
+
+namespace
+{
+/**
+ * @brief Time between two connection attempts.
+ */
+const qint64 RECONNECT_INTERVAL_MS = 1000;
+
+/**
+ * @brief Time between two attempts to send the pending output while the receiver is stalled.
+ */
+const unsigned long RETRY_INTERVAL_MS = 10;
+
+/**
+ * @brief Maximum size of a datagram with several length prefixed messages.
+ */
+const int MAX_DATAGRAM_SIZE = 60000;
+
+/**
+ * @brief Gets the RFC 5424 severity of a level.
+ */
+int syslogSeverity(QLogger::LogLevel level)
+{
+   switch (level)
+   {
+      case QLogger::LogLevel::Trace:
+      case QLogger::LogLevel::Debug:
+         return 7;
+      case QLogger::LogLevel::Info:
+         return 6;
+      case QLogger::LogLevel::Warning:
+         return 4;
+      case QLogger::LogLevel::Error:
+         return 3;
+      case QLogger::LogLevel::Fatal:
+         return 2;
+   }
+
+   return 7;
+}
+}
+
+namespace QLogger
+{
+
+QLoggerSocketWriter::QLoggerSocketWriter(const QString &address, LogLevel level, LogSocketFraming framing,
+                                         LogMessageDisplays messageOptions)
+   : QLoggerWriter(address, level, messageOptions)
+   , mFraming(framing)
+{
+   if (address.startsWith(QLatin1String("unix:")) && address.size() > 5)
+   {
+      mTransport = Transport::Unix;
+      mPath = address.mid(5).toLocal8Bit();
+   }
+   else if (address.startsWith(QLatin1String("udp:")))
+   {
+      const auto separator = address.lastIndexOf(QLatin1Char(':'));
+      auto isPort = false;
+
+      mHost = address.mid(4, separator - 4).toLatin1();
+      mPort = address.mid(separator + 1).toUShort(&isPort);
+
+      if (mHost == "localhost")
+         mHost = "127.0.0.1";
+
+      if (isPort && mPort != 0 && !mHost.isEmpty())
+         mTransport = Transport::Udp;
+   }
+
+   // HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA are the same for all the messages
+   const auto appName = QCoreApplication::applicationName();
+
+   mSyslogHeader = ' ' + QSysInfo::machineHostName().toUtf8() + ' '
+       + (appName.isEmpty() ? QByteArray("-") : appName.toUtf8()) + ' '
+       + QByteArray::number(QCoreApplication::applicationPid()) + " - - ";
+}
+
+QLoggerSocketWriter::~QLoggerSocketWriter()
+{
+   closeSocket();
+}
+
+void QLoggerSocketWriter::write(const QVector<QueuedMessage> &messages)
+{
+   QByteArray data;
+   auto count = 0;
+   auto level = LogLevel::Trace;
+
+   for (const auto &message : messages)
+   {
+      appendFrame(data, message);
+      ++count;
+      level = qMax(level, message.level);
+
+      // Syslog over UDP sends one message per datagram
+      if (mTransport == Transport::Udp && (mFraming == LogSocketFraming::Syslog || data.size() >= MAX_DATAGRAM_SIZE))
+      {
+         addChunk(data, count, level);
+         count = 0;
+         level = LogLevel::Trace;
+      }
+
+      if (getMode() == LogMode::Full)
+         qInfo() << message.text;
+   }
+
+   if (count > 0)
+      addChunk(data, count, level);
+
+   sendPending();
+}
+
+void QLoggerSocketWriter::closeOutput()
+{
+   // Last attempt to deliver what is pending, no matter when the last connection was tried
+   mLastConnection = 0;
+   sendPending();
+
+   for (const auto &chunk : std::as_const(mPending))
+      mDroppedCount.fetch_add(chunk.messages, std::memory_order_relaxed);
+
+   QLoggerMemoryBudget::getInstance()->release(mPendingBytes);
+   mPending.clear();
+   mPendingBytes = 0;
+
+   closeSocket();
+}
+
+unsigned long QLoggerSocketWriter::idleTimeout() const
+{
+   return mPending.isEmpty() ? ULONG_MAX : RETRY_INTERVAL_MS;
+}
+
+void QLoggerSocketWriter::appendFrame(QByteArray &data, const QueuedMessage &message) const
+{
+   const auto text = message.text.toUtf8();
+
+   if (mFraming == LogSocketFraming::LengthPrefixed)
+   {
+      const auto length = qToBigEndian(static_cast<quint32>(text.size()));
+
+      data.append(reinterpret_cast<const char *>(&length), sizeof(length));
+      data.append(text);
+
+      return;
+   }
+
+   // Facility 1 (user-level messages)
+   const auto frame = '<' + QByteArray::number(8 + syslogSeverity(message.level)) + ">1 "
+       + QDateTime::fromMSecsSinceEpoch(message.timestamp, Qt::UTC).toString(Qt::ISODateWithMs).toLatin1()
+       + mSyslogHeader + text;
+
+   if (mTransport == Transport::Unix)
+      data.append(QByteArray::number(frame.size()) + ' ');
+
+   data.append(frame);
+}
+
+void QLoggerSocketWriter::addChunk(QByteArray &data, int messages, LogLevel level)
+{
+   if (!QLoggerMemoryBudget::getInstance()->acquire(data.size(), level))
+   {
+      mDroppedCount.fetch_add(messages, std::memory_order_relaxed);
+      data.clear();
+      return;
+   }
+
+   mPendingBytes += data.size();
+   mPending.append({ data, messages, 0 });
+   data.clear();
+
+   // The oldest chunks are dropped first. A chunk that has been partially sent has to be completed, otherwise the
+   // stream would be corrupted.
+   while (mPendingBytes > mMaxBufferedBytes.load(std::memory_order_relaxed) && mPending.count() > 1)
+   {
+      const auto index = mPending.constFirst().offset > 0 ? 1 : 0;
+
+      mDroppedCount.fetch_add(mPending.at(index).messages, std::memory_order_relaxed);
+      removeChunk(index);
+   }
+}
+
+void QLoggerSocketWriter::removeChunk(int index)
+{
+   const auto size = mPending.at(index).data.size();
+
+   mPendingBytes -= size;
+   mPending.remove(index);
+
+   QLoggerMemoryBudget::getInstance()->release(size);
+}
+
+void QLoggerSocketWriter::sendPending()
+{
+#if defined(Q_OS_UNIX)
+   if (mPending.isEmpty() || (mSocket < 0 && !connectSocket()))
+      return;
+
+#   if defined(MSG_NOSIGNAL)
+   const auto flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#   else
+   const auto flags = MSG_DONTWAIT;
+#   endif
+
+   while (!mPending.isEmpty())
+   {
+      auto &chunk = mPending.first();
+      const auto sent = ::send(mSocket, chunk.data.constData() + chunk.offset, chunk.data.size() - chunk.offset, flags);
+
+      if (sent < 0)
+      {
+         if (errno == EINTR)
+            continue;
+
+         if (errno != EAGAIN && errno != EWOULDBLOCK)
+         {
+            closeSocket();
+            return;
+         }
+
+         // The socket buffer is full. If the receiver doesn't read for a while, the writer goes back to its queue
+         // and the output is retried later.
+         pollfd socket { mSocket, POLLOUT, 0 };
+
+         if (::poll(&socket, 1, static_cast<int>(RETRY_INTERVAL_MS)) <= 0)
+            return;
+
+         continue;
+      }
+
+      chunk.offset += static_cast<int>(sent);
+
+      if (chunk.offset == chunk.data.size())
+      {
+         mSentCount.fetch_add(chunk.messages, std::memory_order_relaxed);
+         removeChunk(0);
+      }
+   }
+#endif
+}
+
+bool QLoggerSocketWriter::connectSocket()
+{
+#if defined(Q_OS_UNIX)
+   const auto now = QDateTime::currentMSecsSinceEpoch();
+
+   if (now - mLastConnection < RECONNECT_INTERVAL_MS)
+      return false;
+
+   mLastConnection = now;
+
+   if (mTransport == Transport::Unix)
+   {
+      sockaddr_un address {};
+      address.sun_family = AF_UNIX;
+
+      if (mPath.size() >= static_cast<int>(sizeof(address.sun_path)))
+         return false;
+
+      std::memcpy(address.sun_path, mPath.constData(), mPath.size());
+
+      mSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+      if (mSocket >= 0 && ::connect(mSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+         closeSocket();
+   }
+   else if (mTransport == Transport::Udp)
+   {
+      sockaddr_in address {};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(mPort);
+
+      if (::inet_pton(AF_INET, mHost.constData(), &address.sin_addr) != 1)
+         return false;
+
+      mSocket = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+      if (mSocket >= 0 && ::connect(mSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+         closeSocket();
+   }
+
+   if (mSocket < 0)
+      return false;
+
+   ::fcntl(mSocket, F_SETFL, ::fcntl(mSocket, F_GETFL) | O_NONBLOCK);
+
+   // A chunk partially sent to the previous connection is sent again from the beginning
+   if (!mPending.isEmpty())
+      mPending.first().offset = 0;
+
+#   if defined(SO_NOSIGPIPE)
+   const int noSigPipe = 1;
+   ::setsockopt(mSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#   endif
+
+   return true;
+#else
+   return false;
+#endif
+}
+
+void QLoggerSocketWriter::closeSocket()
+{
+#if defined(Q_OS_UNIX)
+   if (mSocket >= 0)
+      ::close(mSocket);
+#endif
+
+   mSocket = -1;
+}
+
+}
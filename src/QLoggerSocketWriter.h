@@ -0,0 +1,156 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include "QLoggerWriter.h"
+
+#include <QByteArray>
+#include <QVector>
+
+#include <atomic>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerSocketWriter class sends the messages to a local socket instead of a file. Every batch dequeued
+ * by the writer thread is framed and sent with a single non-blocking call, so the producers never wait for the
+ * receiver. If the receiver stalls or is not available, the batches are kept up to a maximum size and then the
+ * oldest ones are dropped and counted. The connection is retried every second.
+ */
+class QLoggerSocketWriter : public QLoggerWriter
+{
+   Q_OBJECT
+
+public:
+   /**
+    * @brief Constructor that parses the address of the receiver. The connection is done from the writer thread.
+    * @param address "unix:<path>" for a Unix domain stream socket or "udp:<host>:<port>" for a local UDP socket.
+    * @param level The maximum level that is allowed.
+    * @param framing The framing of the messages.
+    * @param messageOptions The message options.
+    */
+   QLoggerSocketWriter(const QString &address, LogLevel level, LogSocketFraming framing,
+                       LogMessageDisplays messageOptions = LogMessageDisplay::Default);
+
+   /**
+    * @brief Destructor that closes the socket.
+    */
+   ~QLoggerSocketWriter() override;
+
+   /**
+    * @brief isValid Checks if the address could be parsed.
+    */
+   bool isValid() const { return mTransport != Transport::Invalid; }
+
+   /**
+    * @brief setMaxBufferedBytes Sets the maximum amount of bytes kept while the receiver is not available.
+    * @param maxBytes The maximum amount of bytes.
+    */
+   void setMaxBufferedBytes(qint64 maxBytes) { mMaxBufferedBytes = maxBytes; }
+
+   /**
+    * @brief getSentCount Gets the amount of messages sent to the receiver.
+    */
+   quint64 getSentCount() const { return mSentCount.load(std::memory_order_relaxed); }
+
+   /**
+    * @brief getDroppedCount Gets the amount of messages dropped because the buffer was full or the writer was closed
+    * before the receiver was available.
+    */
+   quint64 getDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
+protected:
+   void write(const QVector<QueuedMessage> &messages) override;
+   void closeOutput() override;
+   unsigned long idleTimeout() const override;
+
+private:
+   enum class Transport
+   {
+      Invalid,
+      Unix,
+      Udp
+   };
+
+   /**
+    * @brief The Chunk struct is a piece of output sent with one call: a batch of frames on stream sockets or a
+    * datagram on UDP.
+    */
+   struct Chunk
+   {
+      QByteArray data;
+      int messages = 0;
+      int offset = 0;
+   };
+
+   Transport mTransport = Transport::Invalid;
+   LogSocketFraming mFraming;
+   QByteArray mPath;
+   QByteArray mHost;
+   quint16 mPort = 0;
+   QByteArray mSyslogHeader;
+   int mSocket = -1;
+   qint64 mLastConnection = 0;
+   QVector<Chunk> mPending;
+   qint64 mPendingBytes = 0;
+   std::atomic<qint64> mMaxBufferedBytes { 4 * 1024 * 1024 };
+   std::atomic<quint64> mSentCount { 0 };
+   std::atomic<quint64> mDroppedCount { 0 };
+
+   /**
+    * @brief appendFrame Appends a message with the framing of the destination.
+    */
+   void appendFrame(QByteArray &data, const QueuedMessage &message) const;
+
+   /**
+    * @brief addChunk Adds a chunk to the pending output and drops the oldest chunks if the buffer is full. The
+    * pending output is accounted in the memory budget, and a chunk that doesn't fit in it is dropped.
+    * @param data The frames of the chunk. It is cleared.
+    * @param messages The amount of messages in the chunk.
+    * @param level The highest level of the messages in the chunk.
+    */
+   void addChunk(QByteArray &data, int messages, LogLevel level);
+
+   /**
+    * @brief removeChunk Removes a pending chunk and gives its memory back to the budget.
+    */
+   void removeChunk(int index);
+
+   /**
+    * @brief sendPending Sends the pending output until it is empty or the socket would block.
+    */
+   void sendPending();
+
+   /**
+    * @brief connectSocket Connects to the receiver if the last attempt was long enough ago.
+    * @return True if the socket is connected.
+    */
+   bool connectSocket();
+
+   /**
+    * @brief closeSocket Closes the socket so the next send reconnects.
+    */
+   void closeSocket();
+};
+
+}
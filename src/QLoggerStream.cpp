@@ -0,0 +1,118 @@
+#include <QLoggerStream.h>
+
+#include <QLogger.h>
+
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+
+namespace QLogger
+{
+
+bool MessageStream::isWanted(const CallSite &site, const QString &module)
+{
+   return site.isForced() || QLoggerManager::getInstance()->isLevelEnabled(module, site.level());
+}
+
+MessageStream::~MessageStream()
+{
+   // The message is created with its final size and shared with the queue, so the text is not copied again
+   QLoggerManager::getInstance()->enqueueMessage(mSite, mModule, QString(mBuffer.constData(), mBuffer.size()));
+}
+
+MessageStream &MessageStream::operator<<(const char *text)
+{
+   if (!text)
+      return *this;
+
+   const auto length = static_cast<int>(std::strlen(text));
+
+   // Most literals are plain ASCII, so they are widened in place. Otherwise they are decoded as UTF-8
+   for (auto i = 0; i < length; ++i)
+   {
+      if (static_cast<unsigned char>(text[i]) >= 0x80)
+         return *this << QString::fromUtf8(text, length);
+   }
+
+   appendAscii(text, length);
+
+   return *this;
+}
+
+MessageStream &MessageStream::operator<<(const void *pointer)
+{
+   char buffer[24];
+   const auto length = std::snprintf(buffer, sizeof(buffer), "%p", pointer);
+
+   appendAscii(buffer, length);
+
+   return *this;
+}
+
+MessageStream &MessageStream::appendInteger(qint64 value)
+{
+   if (value < 0)
+   {
+      mBuffer.append(QLatin1Char('-'));
+      return appendUnsigned(0 - static_cast<quint64>(value));
+   }
+
+   return appendUnsigned(static_cast<quint64>(value));
+}
+
+MessageStream &MessageStream::appendUnsigned(quint64 value)
+{
+   char buffer[24];
+   const auto end = buffer + sizeof(buffer);
+   auto begin = end;
+
+   do
+   {
+      *--begin = static_cast<char>('0' + value % 10);
+      value /= 10;
+   } while (value != 0);
+
+   appendAscii(begin, static_cast<int>(end - begin));
+
+   return *this;
+}
+
+MessageStream &MessageStream::appendDouble(double value)
+{
+   // Same default precision as QString::number
+   char buffer[32];
+   auto length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+
+   // snprintf follows the C locale, which QCoreApplication takes from the environment, while QString::number always
+   // uses a dot. The separator is replaced in place, so the stream still doesn't allocate.
+   const auto point = std::localeconv()->decimal_point;
+   const auto pointLength = static_cast<int>(std::strlen(point));
+
+   if (pointLength > 0 && (pointLength > 1 || *point != '.'))
+   {
+      if (const auto found = std::strstr(buffer, point))
+      {
+         *found = '.';
+         std::memmove(found + 1, found + pointLength, static_cast<size_t>(buffer + length - found - pointLength + 1));
+         length -= pointLength - 1;
+      }
+   }
+
+   appendAscii(buffer, length);
+
+   return *this;
+}
+
+void MessageStream::appendAscii(const char *text, int length)
+{
+   const auto offset = mBuffer.size();
+
+   mBuffer.resize(offset + length);
+
+   auto data = mBuffer.data() + offset;
+
+   for (auto i = 0; i < length; ++i)
+      data[i] = QLatin1Char(text[i]);
+}
+
+}
@@ -0,0 +1,40 @@
+#include "QLoggerVolumeReporter.h"
+
+#include <QLogger.h>
+
+namespace QLogger
+{
+
+QLoggerVolumeReporter::QLoggerVolumeReporter(const QString &module, int interval, int count)
+   : QLoggerPeriodicReporter(interval)
+   , mModule(module)
+   , mCount(count)
+{
+}
+
+void QLoggerVolumeReporter::configure(const QString &module, int interval, int count)
+{
+   {
+      QMutexLocker locker(&mMutex);
+      mModule = module;
+      mCount = count;
+   }
+
+   setInterval(interval);
+}
+
+void QLoggerVolumeReporter::report()
+{
+   QString module;
+   int count;
+
+   {
+      QMutexLocker locker(&mMutex);
+      module = mModule;
+      count = mCount;
+   }
+
+   QLoggerManager::getInstance()->reportVolume(module, count);
+}
+
+}
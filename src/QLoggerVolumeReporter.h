@@ -0,0 +1,63 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include "QLoggerPeriodicReporter.h"
+
+#include <QString>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerVolumeReporter class periodically writes the call sites that have logged the most to a module,
+ * so the noisy call sites can be found from the logs themselves.
+ */
+class QLoggerVolumeReporter : public QLoggerPeriodicReporter
+{
+   Q_OBJECT
+
+public:
+   /**
+    * @brief Constructor.
+    * @param module The module that receives the reports.
+    * @param interval The time between two reports in milliseconds.
+    * @param count The amount of call sites in every report.
+    */
+   QLoggerVolumeReporter(const QString &module, int interval, int count);
+
+   /**
+    * @brief configure Changes the module, the interval and the size of the reports.
+    */
+   void configure(const QString &module, int interval, int count);
+
+   /**
+    * @brief report Writes the call sites that have logged the most now.
+    */
+   void report() override;
+
+private:
+   QString mModule;
+   int mCount;
+};
+
+}
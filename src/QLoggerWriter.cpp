@@ -1,37 +1,180 @@
 #include "QLoggerWriter.h"
+#include "QLoggerBufferPool.h"
+#include "QLoggerMemoryBudget.h"
 
 #include <QDateTime>
+#include <QDeadlineTimer>
 #include <QFile>
-#include <QTextStream>
+#include <QThreadPool>
 #include <QDir>
 #include <QDebug>
 
+#include <chrono>
+#include <climits>
+
 namespace
 {
 /**
- * @brief Converts the given level in a QString.
+ * @brief Converts the given level in a QLatin1String.
  * @param level The log level in LogLevel format.
  * @return The string with the name of the log level.
  */
-QString levelToText(const QLogger::LogLevel &level)
+QLatin1String levelToText(const QLogger::LogLevel &level)
 {
    switch (level)
    {
       case QLogger::LogLevel::Trace:
-         return "Trace";
+         return QLatin1String("Trace");
       case QLogger::LogLevel::Debug:
-         return "Debug";
+         return QLatin1String("Debug");
       case QLogger::LogLevel::Info:
-         return "Info";
+         return QLatin1String("Info");
       case QLogger::LogLevel::Warning:
-         return "Warning";
+         return QLatin1String("Warning");
       case QLogger::LogLevel::Error:
-         return "Error";
+         return QLatin1String("Error");
       case QLogger::LogLevel::Fatal:
-         return "Fatal";
+         return QLatin1String("Fatal");
+   }
+
+   return QLatin1String();
+}
+
+/**
+ * @brief Amount of queued messages that ends the wait for a larger batch.
+ */
+const int LINGER_BATCH_SIZE = 1024;
+
+/**
+ * @brief Amount of consecutive priority batches written before the other messages get a turn.
+ */
+const int MAX_PRIORITY_BATCHES = 8;
+
+/**
+ * @brief Whether the current thread is a writer thread.
+ */
+thread_local bool tlsIsWriterThread = false;
+
+/**
+ * @brief Appends a number to the text without creating temporary strings.
+ * @param text The text where the number is appended.
+ * @param value The number.
+ */
+void appendNumber(QString &text, qint64 value)
+{
+   char buffer[24];
+   const auto end = buffer + sizeof(buffer);
+   auto begin = end;
+   auto absolute = value < 0 ? 0 - static_cast<quint64>(value) : static_cast<quint64>(value);
+
+   do
+   {
+      *--begin = static_cast<char>('0' + absolute % 10);
+      absolute /= 10;
+   } while (absolute != 0);
+
+   if (value < 0)
+      *--begin = '-';
+
+   text.append(QLatin1String(begin, static_cast<int>(end - begin)));
+}
+
+/**
+ * @brief Appends a double to the text with enough precision to read back the same value. NaN and infinite values
+ * have no JSON representation, so they are appended as null.
+ * @param text The text where the number is appended.
+ * @param value The number.
+ */
+void appendDouble(QString &text, double value)
+{
+   if (!qIsFinite(value))
+   {
+      text.append(QLatin1String("null"));
+      return;
+   }
+
+   // QByteArray::number doesn't depend on the C locale, which could use a comma as decimal separator
+   text.append(QLatin1String(QByteArray::number(value, 'g', 17)));
+}
+
+/**
+ * @brief Appends a quoted JSON string to the text, escaping the quotes, the backslashes and the control characters.
+ * @param text The text where the string is appended.
+ * @param value The string.
+ */
+void appendJsonString(QString &text, const QString &value)
+{
+   static const char hex[] = "0123456789abcdef";
+
+   text.append(QLatin1Char('"'));
+
+   const auto end = value.constData() + value.size();
+   auto begin = value.constData();
+
+   for (auto iter = begin; iter != end; ++iter)
+   {
+      const auto c = iter->unicode();
+
+      if (c >= 0x20 && c != '"' && c != '\\')
+         continue;
+
+      // Copy the run of characters that don't need escaping at once
+      text.append(begin, static_cast<int>(iter - begin));
+      begin = iter + 1;
+
+      switch (c)
+      {
+         case '"':
+            text.append(QLatin1String("\\\""));
+            break;
+         case '\\':
+            text.append(QLatin1String("\\\\"));
+            break;
+         case '\n':
+            text.append(QLatin1String("\\n"));
+            break;
+         case '\r':
+            text.append(QLatin1String("\\r"));
+            break;
+         case '\t':
+            text.append(QLatin1String("\\t"));
+            break;
+         default:
+         {
+            const char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            text.append(QLatin1String(escaped, sizeof(escaped)));
+            break;
+         }
+      }
    }
 
-   return QString();
+   text.append(begin, static_cast<int>(end - begin));
+   text.append(QLatin1Char('"'));
+}
+
+/**
+ * @brief Appends the value of the field to the text. Strings are always escaped as JSON strings, so a quote or a
+ * line break in the value can't break the line.
+ * @param text The text where the value is appended.
+ * @param field The field.
+ */
+void appendFieldValue(QString &text, const QLogger::Field &field)
+{
+   switch (field.type())
+   {
+      case QLogger::Field::Type::Integer:
+         appendNumber(text, field.toInteger());
+         break;
+      case QLogger::Field::Type::Double:
+         appendDouble(text, field.toDouble());
+         break;
+      case QLogger::Field::Type::Bool:
+         text.append(field.toBool() ? QLatin1String("true") : QLatin1String("false"));
+         break;
+      case QLogger::Field::Type::String:
+         appendJsonString(text, field.toString());
+         break;
+   }
 }
 }
 
@@ -61,199 +204,716 @@ QLoggerWriter::QLoggerWriter(const QString &fileDestination, LogLevel level, con
    else if (!fileDestination.contains(QLatin1Char('.')))
       mFileDestination.append(QString::fromLatin1(".log"));
 
-   if (mMode == LogMode::Full || mMode == LogMode::OnlyFile)
-      dir.mkpath(QStringLiteral("."));
+   mNextFileDestination = mFileDestination + QStringLiteral(".next");
+
+   // The folder is created when the file is opened, so destinations that never log don't touch the disk
+}
+
+QLoggerWriter::QLoggerWriter(const QString &destination, LogLevel level, LogMessageDisplays messageOptions)
+   : mFileDestination(destination)
+   , mFileSuffixIfFull(LogFileDisplay::DateTime)
+   , mMode(LogMode::OnlyFile)
+   , mLevel(level)
+   , mMessageOptions(messageOptions)
+{
 }
 
 void QLoggerWriter::setLogMode(LogMode mode)
 {
+   QMutexLocker locker(&mutex);
+
    mMode = mode;
 
-   if (mMode == LogMode::Full || mMode == LogMode::OnlyFile)
+   if (mode != LogMode::Disabled && !mStartOnFirstMessage && !this->isRunning())
+      start();
+}
+
+void QLoggerWriter::startOnFirstMessage(const QString &startupMessage)
+{
+   QMutexLocker locker(&mutex);
+
+   mStartOnFirstMessage = true;
+   mStartupMessage = startupMessage;
+}
+
+bool QLoggerWriter::openFile()
+{
+   // Reopens the file if it was moved or removed from outside, otherwise the logs would go to a file without name.
+   // Looking it up costs a system call, so it is only done when a write failed or the file has just been rotated.
+   if (mFile && !mIsFileChecked && !QFile::exists(mFileDestination))
+      closeFiles();
+
+   mIsFileChecked = true;
+
+   if (mFile)
+      return true;
+
+   mFile = new QFile(mFileDestination);
+
+   const auto openMode = QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append;
+
+   // The folder is created the first time, or again if it has been removed
+   if (!mFile->open(openMode) && (!QDir().mkpath(mFileDestinationFolder) || !mFile->open(openMode)))
    {
-      QDir dir(mFileDestinationFolder);
-      dir.mkpath(QStringLiteral("."));
+      delete mFile;
+      mFile = nullptr;
+
+      return false;
    }
 
-   if (mode != LogMode::Disabled && !this->isRunning())
-      start();
+   mFileSize = mFile->size();
+   mStream.setDevice(mFile);
+
+   return true;
 }
 
-QString QLoggerWriter::renameFileIfFull()
+void QLoggerWriter::prepareNextFile()
 {
-   QFile file(mFileDestination);
+   if (mNextFile || (mRotation == LogRotation::Size && mMaxFileSize <= 0))
+      return;
+
+   mNextFile = new QFile(mNextFileDestination);
 
-   // Rename file if it's full
-   if (file.size() >= mMaxFileSize)
+   if (!mNextFile->open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
    {
-      QString newName;
+      delete mNextFile;
+      mNextFile = nullptr;
+   }
+}
+
+void QLoggerWriter::closeFiles()
+{
+   closeIndex();
 
-      const auto fileDestination = mFileDestination.left(mFileDestination.lastIndexOf('.'));
-      const auto fileExtension = mFileDestination.mid(mFileDestination.lastIndexOf('.') + 1);
+   if (mFile)
+   {
+      mStream.flush();
+      mStream.setDevice(nullptr);
+      mFile->close();
+      delete mFile;
+      mFile = nullptr;
+   }
 
-      if (mFileSuffixIfFull == LogFileDisplay::DateTime)
-      {
-         newName
-             = QString("%1_%2.%3")
-                   .arg(fileDestination, QDateTime::currentDateTime().toString("dd_MM_yy__hh_mm_ss"), fileExtension);
-      }
-      else
-         newName = generateDuplicateFilename(fileDestination, fileExtension);
+   if (mNextFile)
+   {
+      mNextFile->remove();
+      delete mNextFile;
+      mNextFile = nullptr;
+   }
+}
+
+QString QLoggerWriter::rotateIfNeeded()
+{
+   const auto now = QDateTime::currentMSecsSinceEpoch();
+   const auto rotation = mRotation;
+
+   if (rotation != mScheduledRotation)
+   {
+      mScheduledRotation = rotation;
+      mNextRotationTime = nextRotationTime(rotation, now);
+   }
+
+   const auto isTimeReached = mNextRotationTime >= 0 && now >= mNextRotationTime;
+
+   if (isTimeReached)
+      mNextRotationTime = nextRotationTime(rotation, now);
+
+   const auto isSizeReached = mMaxFileSize > 0 && mFileSize >= mMaxFileSize;
+
+   // An empty file is kept even if the period is over
+   if (mFileSize == 0 || (!isSizeReached && !isTimeReached))
+      return QString();
+
+   QString newName;
+
+   const auto fileDestination = mFileDestination.left(mFileDestination.lastIndexOf('.'));
+   const auto fileExtension = mFileDestination.mid(mFileDestination.lastIndexOf('.') + 1);
+
+   if (mFileSuffixIfFull == LogFileDisplay::DateTime)
+   {
+      newName = QString("%1_%2.%3")
+                    .arg(fileDestination, QDateTime::currentDateTime().toString("dd_MM_yy__hh_mm_ss"), fileExtension);
+   }
+   else
+      newName = generateNumberedFilename(fileDestination, fileExtension);
+
+   mStream.flush();
+
+   const auto hasIndex = mIndexFile != nullptr;
+
+   closeIndex();
+
+   // The next file is usually open already, so the switch is only a rename and a handle swap
+   prepareNextFile();
+
+   if (!renameOpenFile(mFile, mFileDestination, newName))
+      return QString();
+
+   if (hasIndex)
+   {
+      const auto indexPath = QLoggerIndex::indexFilePath(newName);
+
+      QFile::remove(indexPath);
+      QFile::rename(QLoggerIndex::indexFilePath(mFileDestination), indexPath);
+   }
+
+   const auto oldFile = mFile;
 
-      const auto renamed = file.rename(mFileDestination, newName);
+   if (mNextFile && renameOpenFile(mNextFile, mNextFileDestination, mFileDestination))
+   {
+      mFile = mNextFile;
+      mNextFile = nullptr;
+      mFileSize = 0;
+      mStream.setDevice(mFile);
+   }
+   else
+   {
+      mFile = nullptr;
+      mStream.setDevice(nullptr);
+      openFile();
+   }
+
+   // Closing the old file flushes it to the disk, so it is done out of the writer thread
+   QThreadPool::globalInstance()->start([oldFile]() {
+      oldFile->close();
+      delete oldFile;
+   });
+
+   return newName;
+}
+
+void QLoggerWriter::openIndex()
+{
+   mIndexFile = new QFile(QLoggerIndex::indexFilePath(mFileDestination));
 
-      return renamed ? newName : QString();
+   // An index left next to an empty log file describes a file that doesn't exist anymore
+   const auto openMode = mFileSize == 0 ? QIODevice::Truncate : QIODevice::Append;
+
+   if (!mIndexFile->open(QIODevice::WriteOnly | openMode))
+   {
+      delete mIndexFile;
+      mIndexFile = nullptr;
+
+      return;
    }
 
-   return QString();
+   mIndexStream.setDevice(mIndexFile);
+
+   if (mIndexFile->size() == 0)
+      QLoggerIndex::writeHeader(mIndexStream);
+
+   mIndexBlock = QLoggerIndexEntry();
+   mIndexBlock.offset = mFileSize;
+   mIndexBlockBytes = 0;
+}
+
+void QLoggerWriter::closeIndex()
+{
+   if (!mIndexFile)
+      return;
+
+   writeIndexBlock();
+
+   mIndexStream.setDevice(nullptr);
+   mIndexFile->close();
+   delete mIndexFile;
+   mIndexFile = nullptr;
 }
 
-QString QLoggerWriter::generateDuplicateFilename(const QString &fileDestination, const QString &fileExtension,
-                                                 int fileSuffixNumber)
+void QLoggerWriter::indexMessage(const QueuedMessage &message)
 {
-   QString path(fileDestination);
-   if (fileSuffixNumber > 1)
-      path = QString("%1(%2).%3").arg(fileDestination, QString::number(fileSuffixNumber), fileExtension);
+   if (mIndexBlock.levels == 0)
+   {
+      mIndexBlock.firstTimestamp = message.timestamp;
+      mIndexBlock.lastTimestamp = message.timestamp;
+   }
    else
-      path.append(QString(".%1").arg(fileExtension));
+   {
+      // Priority messages are written before older ones, so the block stores its time range
+      mIndexBlock.firstTimestamp = qMin(mIndexBlock.firstTimestamp, message.timestamp);
+      mIndexBlock.lastTimestamp = qMax(mIndexBlock.lastTimestamp, message.timestamp);
+   }
+
+   mIndexBlock.levels |= 1u << static_cast<int>(message.level);
+   mIndexBlockBytes += message.text.size() + 1;
+
+   if (mIndexBlockBytes >= mIndexBlockSize)
+      writeIndexBlock();
+}
 
-   // A name already exists, increment the number and check again
-   if (QFileInfo::exists(path))
-      return generateDuplicateFilename(fileDestination, fileExtension, fileSuffixNumber + 1);
+void QLoggerWriter::writeIndexBlock()
+{
+   if (!mIndexFile || !mFile || mIndexBlock.levels == 0)
+      return;
+
+   // The position is only exact once the text stream is flushed
+   mStream.flush();
+
+   const auto end = mFile->pos();
+
+   mIndexBlock.length = end - mIndexBlock.offset;
+   QLoggerIndex::writeEntry(mIndexStream, mIndexBlock);
+   mIndexFile->flush();
+
+   mIndexBlock = QLoggerIndexEntry();
+   mIndexBlock.offset = end;
+   mIndexBlockBytes = 0;
+}
+
+bool QLoggerWriter::renameOpenFile(QFile *file, const QString &from, const QString &to)
+{
+   if (QFile::rename(from, to))
+      return true;
+
+   // Some platforms don't allow to rename a file while it is open
+   const auto openMode = file->openMode();
+
+   file->close();
+
+   const auto renamed = QFile::rename(from, to);
+
+   file->setFileName(renamed ? to : from);
+   file->open(openMode);
+
+   return renamed;
+}
+
+qint64 QLoggerWriter::nextRotationTime(LogRotation rotation, qint64 now)
+{
+   const auto current = QDateTime::fromMSecsSinceEpoch(now);
+
+   switch (rotation)
+   {
+      case LogRotation::Hourly:
+         return QDateTime(current.date(), QTime(current.time().hour(), 0)).addSecs(3600).toMSecsSinceEpoch();
+      case LogRotation::Daily:
+         return QDateTime(current.date().addDays(1), QTime(0, 0)).toMSecsSinceEpoch();
+      case LogRotation::Size:
+         break;
+   }
+
+   return -1;
+}
+
+QString QLoggerWriter::generateNumberedFilename(const QString &fileDestination, const QString &fileExtension)
+{
+   if (mLastFileNumber < 0)
+      mLastFileNumber = findLastFileNumber(fileDestination, fileExtension);
+
+   // The first file is the one without number, so the rotated files start at 2
+   auto fileSuffixNumber = mLastFileNumber + 1;
+
+   if (mMaxRotatedFiles > 0 && fileSuffixNumber > mMaxRotatedFiles + 1)
+      fileSuffixNumber = 2;
+
+   mLastFileNumber = fileSuffixNumber;
+
+   const auto path = QString("%1(%2).%3").arg(fileDestination, QString::number(fileSuffixNumber), fileExtension);
+
+   // The rolling window reuses the numbers, so the oldest file is replaced
+   if (mMaxRotatedFiles > 0)
+   {
+      QFile::remove(path);
+      QFile::remove(QLoggerIndex::indexFilePath(path));
+   }
 
-   // No file exists at the given location, so no need to continue
    return path;
 }
 
-void QLoggerWriter::write(QVector<QString> messages)
+int QLoggerWriter::findLastFileNumber(const QString &fileDestination, const QString &fileExtension) const
+{
+   const QFileInfo destinationInfo(fileDestination);
+   const auto prefix = QString("%1(").arg(destinationInfo.fileName());
+   const auto suffix = QString(").%1").arg(fileExtension);
+
+   QDir dir(destinationInfo.absolutePath());
+   const auto nameFilter = QString("%1*%2").arg(prefix, suffix);
+   const auto entries = dir.entryInfoList(QStringList { nameFilter }, QDir::Files, QDir::Time);
+
+   auto lastNumber = 1;
+
+   // Sorted from the newest to the oldest
+   for (const auto &entry : entries)
+   {
+      const auto fileName = entry.fileName();
+      auto ok = false;
+      const auto number = fileName.mid(prefix.size(), fileName.size() - prefix.size() - suffix.size()).toInt(&ok);
+
+      if (!ok || number < 2)
+         continue;
+
+      // With a rolling window the newest file is the last one, no matter its number
+      if (mMaxRotatedFiles > 0)
+         return number <= mMaxRotatedFiles + 1 ? number : 1;
+
+      lastNumber = qMax(lastNumber, number);
+   }
+
+   return lastNumber;
+}
+
+void QLoggerWriter::write(const QVector<QueuedMessage> &messages)
 {
    // Write data to console
    if (mMode == LogMode::OnlyConsole)
    {
       for (const auto &message : messages)
-         qInfo() << message;
+         qInfo() << message.text;
 
       return;
    }
 
-   // Write data to file
-   QFile file(mFileDestination);
+   // Write data to file. The file is kept open between batches and its size is tracked in memory.
+   if (!openFile())
+      return;
+
+   const auto prevFilename = rotateIfNeeded();
+
+   if (!mFile)
+      return;
 
-   const auto prevFilename = renameFileIfFull();
+   if (mIndexBlockSize > 0 && !mIndexFile)
+      openIndex();
+   else if (mIndexBlockSize <= 0 && mIndexFile)
+      closeIndex();
 
-   if (file.open(QIODevice::ReadWrite | QIODevice::Text | QIODevice::Append))
+   if (!prevFilename.isEmpty())
    {
-      QTextStream out(&file);
+      mIsFileChecked = false;
+      mStream << QString("Previous log %1\n").arg(prevFilename);
 
-      if (!prevFilename.isEmpty())
-         out << QString("Previous log %1\n").arg(prevFilename);
+      std::function<void(const QString &)> rotationCallback;
 
-      for (const auto &message : messages)
       {
-         out << message;
-
-         if (mMode == LogMode::Full)
-            qInfo() << message;
+         QMutexLocker locker(&mutex);
+         rotationCallback = mRotationCallback;
       }
 
-      file.close();
+      if (rotationCallback)
+         rotationCallback(prevFilename);
+   }
+
+   for (const auto &message : messages)
+   {
+      mStream << message.text << '\n';
+
+      if (mMode == LogMode::Full)
+         qInfo() << message.text;
+
+      if (mIndexFile)
+         indexMessage(message);
    }
+
+   mStream.flush();
+   mFileSize = mFile->pos();
+
+   if (mStream.status() != QTextStream::Ok || mFile->error() != QFileDevice::NoError)
+   {
+      mIsFileChecked = false;
+      mStream.resetStatus();
+      mFile->unsetError();
+   }
+
+   // The next file is opened after the batch is written, so the rotation doesn't wait for the file system
+   prepareNextFile();
 }
 
-void QLoggerWriter::enqueue(const QDateTime &date, const QString &threadId, const QString &module, LogLevel level,
-                            const QString &function, const QString &fileName, int line, const QString &message, ListenerCallback callback)
+void QLoggerWriter::enqueue(const QString &text, LogLevel level, qint64 timestamp, bool priority)
 {
    QMutexLocker locker(&mutex);
 
    if (mMode == LogMode::Disabled)
       return;
 
-   QString fileLine;
+   // Messages that don't fit in the memory budget are dropped
+   if (!QLoggerMemoryBudget::getInstance()->acquire(QLoggerMemoryBudget::messageCost(text), level))
+      return;
+
+   const auto time = timestamp < 0 ? QDateTime::currentMSecsSinceEpoch() : timestamp;
+
+   if (mStartOnFirstMessage)
+      startWithFirstMessage(time);
+
+   const auto isUrgent = priority || level >= LogLevel::Error;
+
+   // Skipping the queue reorders the lines, so it is only done if the destination writes the sequence number that
+   // restores the original order
+   const auto isSequenced = mMessageOptions.testFlag(LogMessageDisplay::Sequence)
+       || mMessageOptions.testFlag(LogMessageDisplay::Json);
+
+   if (isUrgent && isSequenced)
+      mPriorityMessages.append({ text, level, time });
+   else
+   {
+      mMessages.append({ text, level, time });
+      mHasUrgentMessages = mHasUrgentMessages || isUrgent;
+   }
+
+   // The writer is only woken up if it is sleeping, so a writer that is busy doesn't cost a system call per message
+   const auto isBatchReady = isUrgent || mMessages.size() >= LINGER_BATCH_SIZE;
+
+   if (!mIsStop && (mIsWaiting || (mIsLingering && isBatchReady)))
+      mQueueNotEmpty.wakeOne();
+}
+
+quint32 QLoggerWriter::layoutKey() const
+{
+   // The file and line are only displayed if the level of the destination is Debug or lower
+   return static_cast<quint32>(mMessageOptions) | (mLevel <= LogLevel::Debug ? 1u << 31 : 0u);
+}
+
+QString QLoggerWriter::format(const QLoggerRecord &record) const
+{
+   QString text;
+
+   format(record, text);
+
+   return text;
+}
+
+void QLoggerWriter::format(const QLoggerRecord &record, QString &text) const
+{
+   if (mMessageOptions.testFlag(LogMessageDisplay::Json))
+   {
+      formatJson(record, text);
+      return;
+   }
+
+   const auto &fileName = record.fileName;
+   const auto &function = record.function;
+   const auto line = record.line;
+   const auto isDefault = mMessageOptions.testFlag(LogMessageDisplay::Default);
+
+   if (isDefault || mMessageOptions.testFlag(LogMessageDisplay::LogLevel))
+   {
+      text.append(QLatin1Char('['));
+      text.append(levelToText(record.level));
+      text.append(QLatin1Char(']'));
+   }
+
+   if (isDefault || mMessageOptions.testFlag(LogMessageDisplay::ModuleName))
+   {
+      text.append(QLatin1Char('['));
+      text.append(record.module);
+      text.append(QLatin1Char(']'));
+   }
+
+   if (isDefault || mMessageOptions.testFlag(LogMessageDisplay::DateTime))
+   {
+      text.append(QLatin1Char('['));
+      appendNumber(text, record.timestamp / 1000);
+      text.append(QLatin1Char(']'));
+   }
+
+   if (mMessageOptions.testFlag(LogMessageDisplay::Sequence))
+   {
+      text.append(QLatin1String("[#"));
+      appendNumber(text, static_cast<qint64>(record.sequence));
+      text.append(QLatin1Char(']'));
+   }
+
+   if (isDefault || mMessageOptions.testFlag(LogMessageDisplay::ThreadId))
+   {
+      text.append(QLatin1Char('['));
+      text.append(record.threadId);
+      text.append(QLatin1Char(']'));
+   }
+
    if (mMessageOptions.testFlag(LogMessageDisplay::File) && mMessageOptions.testFlag(LogMessageDisplay::Line)
        && !fileName.isEmpty() && line > 0 && mLevel <= LogLevel::Debug)
    {
-      fileLine = QString("{%1:%2}").arg(fileName, QString::number(line));
+      text.append(QLatin1Char('{'));
+      text.append(fileName);
+      text.append(QLatin1Char(':'));
+      appendNumber(text, line);
+      text.append(QLatin1Char('}'));
    }
    else if (mMessageOptions.testFlag(LogMessageDisplay::File) && mMessageOptions.testFlag(LogMessageDisplay::Function)
             && !fileName.isEmpty() && !function.isEmpty() && mLevel <= LogLevel::Debug)
    {
-      fileLine = QString("{%1}{%2}").arg(fileName, function);
+      text.append(QLatin1Char('{'));
+      text.append(fileName);
+      text.append(QLatin1String("}{"));
+      text.append(function);
+      text.append(QLatin1Char('}'));
    }
 
-   QString text;
-   if (mMessageOptions.testFlag(LogMessageDisplay::Default))
+   if (isDefault || mMessageOptions.testFlag(LogMessageDisplay::Message))
    {
-      text = QString("[%1][%2][%3][%4]%5 %6")
-                 .arg(levelToText(level), module)
-                 .arg(date.toSecsSinceEpoch())
-                 .arg(threadId, fileLine, message);
-   }
-   else
-   {
-      if (mMessageOptions.testFlag(LogMessageDisplay::LogLevel))
-         text.append(QString("[%1]").arg(levelToText(level)));
+      if (!text.isEmpty())
+         text.append(QLatin1Char(' '));
 
-      if (mMessageOptions.testFlag(LogMessageDisplay::ModuleName))
-         text.append(QString("[%1]").arg(module));
+      text.append(record.message);
+   }
 
-      if (mMessageOptions.testFlag(LogMessageDisplay::DateTime))
-         text.append(QString("[%1]").arg(date.toSecsSinceEpoch()));
+   appendFields(text, record.fields);
+}
 
-      if (mMessageOptions.testFlag(LogMessageDisplay::ThreadId))
-         text.append(QString("[%1]").arg(threadId));
+void QLoggerWriter::appendFields(QString &text, const Fields &fields)
+{
+   for (const auto &field : fields)
+   {
+      text.append(QLatin1Char(' '));
+      text.append(QLatin1String(field.escapedKey()));
+      text.append(QLatin1Char('='));
+      appendFieldValue(text, field);
+   }
+}
 
-      if (!fileLine.isEmpty())
-      {
-         if (fileLine.startsWith(QChar::Space))
-            fileLine = fileLine.right(1);
+void QLoggerWriter::formatJson(const QLoggerRecord &record, QString &text) const
+{
+   text.append(QLatin1String("{\"ts\":"));
+   appendNumber(text, record.timestamp);
+   text.append(QLatin1String(",\"level\":\""));
+   text.append(levelToText(record.level));
+   text.append(QLatin1String("\",\"module\":"));
+   appendJsonString(text, record.module);
+   text.append(QLatin1String(",\"thread\":"));
+   appendJsonString(text, record.threadId);
+   text.append(QLatin1String(",\"seq\":"));
+   appendNumber(text, static_cast<qint64>(record.sequence));
+
+   if (!record.fileName.isEmpty())
+   {
+      text.append(QLatin1String(",\"file\":"));
+      appendJsonString(text, record.fileName);
+      text.append(QLatin1String(",\"line\":"));
+      appendNumber(text, record.line);
+   }
 
-         text.append(fileLine);
-      }
-      if (mMessageOptions.testFlag(LogMessageDisplay::Message))
-      {
-         if (text.isEmpty() || text.endsWith(QChar::Space))
-            text.append(QString("%1").arg(message));
-         else
-            text.append(QString(" %1").arg(message));
-      }
+   if (!record.function.isEmpty())
+   {
+      text.append(QLatin1String(",\"function\":"));
+      appendJsonString(text, record.function);
    }
 
-   if (callback)
-       callback(text);
+   text.append(QLatin1String(",\"msg\":"));
+   appendJsonString(text, record.message);
 
-   text.append(QString::fromLatin1("\n"));
+   for (const auto &field : record.fields)
+   {
+      // The keys are escaped once, when the field is built
+      text.append(QLatin1String(",\""));
+      text.append(QLatin1String(field.escapedKey()));
+      text.append(QLatin1String("\":"));
+      appendFieldValue(text, field);
+   }
 
-   mMessages.append(text);
+   text.append(QLatin1Char('}'));
+}
 
-   if (!mIsStop)
-      mQueueNotEmpty.wakeAll();
+bool QLoggerWriter::isWriterThread()
+{
+   return tlsIsWriterThread;
 }
 
 void QLoggerWriter::run()
 {
-   if (!mQuit)
-   {
-      QMutexLocker locker(&mutex);
-      mQueueNotEmpty.wait(&mutex);
-   }
+   tlsIsWriterThread = true;
 
-   while (!mQuit)
+   forever
    {
-      decltype(mMessages) copy;
-
       {
          QMutexLocker locker(&mutex);
-         std::swap(copy, mMessages);
+
+         while (!mQuit && mMessages.isEmpty() && mPriorityMessages.isEmpty())
+         {
+            mIsWaiting = true;
+
+            // Destinations with pending output wake up to retry it
+            const auto isWoken = mQueueNotEmpty.wait(&mutex, idleTimeout());
+
+            mIsWaiting = false;
+
+            if (!isWoken)
+               break;
+         }
+
+         if (mQuit && mMessages.isEmpty() && mPriorityMessages.isEmpty())
+            break;
+
+         // Waits a bit for more messages, unless the batch is already large or there are Error or Fatal messages
+         if (mBatchDelay > 0 && !mQuit && mPriorityMessages.isEmpty() && !mHasUrgentMessages
+             && mMessages.size() < LINGER_BATCH_SIZE)
+         {
+            mIsLingering = true;
+            mQueueNotEmpty.wait(&mutex, QDeadlineTimer(std::chrono::microseconds(mBatchDelay), Qt::PreciseTimer));
+            mIsLingering = false;
+         }
+
+         // Error and Fatal messages are written alone so they reach the disk without waiting for the backlog, but a
+         // flood of them doesn't hold the backlog forever. The queues are swapped with the write buffer so their
+         // capacity is reused.
+         if (!mPriorityMessages.isEmpty() && (mMessages.isEmpty() || mPriorityBatches < MAX_PRIORITY_BATCHES))
+         {
+            std::swap(mWriteBuffer, mPriorityMessages);
+            ++mPriorityBatches;
+         }
+         else
+         {
+            std::swap(mWriteBuffer, mMessages);
+            mPriorityBatches = 0;
+            mHasUrgentMessages = false;
+         }
       }
 
-      write(std::move(copy));
+      write(mWriteBuffer);
 
-      if (!mQuit)
+      const auto pool = QLoggerBufferPool::getInstance();
+      const auto budget = QLoggerMemoryBudget::getInstance();
+
+      for (auto &message : mWriteBuffer)
       {
-         QMutexLocker locker(&mutex);
-         mQueueNotEmpty.wait(&mutex);
+         budget->release(QLoggerMemoryBudget::messageCost(message.text));
+         pool->release(message.text);
       }
+
+      mWriteBuffer.clear();
    }
+
+   closeOutput();
+}
+
+void QLoggerWriter::closeOutput()
+{
+   closeFiles();
+}
+
+unsigned long QLoggerWriter::idleTimeout() const
+{
+   return ULONG_MAX;
+}
+
+void QLoggerWriter::setRotationCallback(std::function<void(const QString &)> callback)
+{
+   QMutexLocker locker(&mutex);
+   mRotationCallback = std::move(callback);
+}
+
+void QLoggerWriter::startWithFirstMessage(qint64 timestamp)
+{
+   mStartOnFirstMessage = false;
+
+   const auto budget = QLoggerMemoryBudget::getInstance();
+
+   if (!mStartupMessage.isEmpty() && budget->acquire(QLoggerMemoryBudget::messageCost(mStartupMessage), LogLevel::Info))
+      mMessages.append({ mStartupMessage, LogLevel::Info, timestamp });
+
+   mStartupMessage.clear();
+
+   start();
+}
+
+int QLoggerWriter::getBatchDelay() const
+{
+   QMutexLocker locker(&mutex);
+   return mBatchDelay;
+}
+
+void QLoggerWriter::setBatchDelay(int microseconds)
+{
+   QMutexLocker locker(&mutex);
+   mBatchDelay = qMax(0, microseconds);
 }
 
 void QLoggerWriter::closeDestination()
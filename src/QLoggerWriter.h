@@ -23,6 +23,11 @@
 
 #include <QLoggerTypes.h>
 
+#include "QLoggerIndex.h"
+#include "QLoggerRecord.h"
+
+#include <QFile>
+#include <QTextStream>
 #include <QThread>
 #include <QWaitCondition>
 #include <QMutex>
@@ -60,6 +65,11 @@ public:
     */
    QString getFileDestination() const { return mFileDestination; }
 
+   /**
+    * @brief Path and name of the file that is opened ahead of time to replace the current one when it is rotated.
+    */
+   QString getNextFileDestination() const { return mNextFileDestination; }
+
    /**
     * @brief Gets the current logging mode.
     * @return The level.
@@ -72,6 +82,13 @@ public:
     */
    void setLogMode(LogMode mode);
 
+   /**
+    * @brief startOnFirstMessage Defers the writer thread until the first message is enqueued, so registering a
+    * destination that never logs doesn't start a thread nor touch the disk.
+    * @param startupMessage Formatted message written before the first message. If empty, nothing is written.
+    */
+   void startOnFirstMessage(const QString &startupMessage = QString());
+
    /**
     * @brief Gets the current level threshold.
     * @return The level.
@@ -92,10 +109,63 @@ public:
 
    /**
     * @brief setMaxFileSize Sets the max file size for this destination.
-    * @param maxSize The new file size
+    * @param maxSize The new file size. If 0, the file is not rotated by size.
     */
    void setMaxFileSize(int maxSize) { mMaxFileSize = maxSize; }
 
+   /**
+    * @brief Gets the maximum amount of numbered files kept when rotating.
+    * @return The maximum amount. If 0, there is no limit.
+    */
+   int getMaxRotatedFiles() const { return mMaxRotatedFiles; }
+
+   /**
+    * @brief setMaxRotatedFiles Sets the maximum amount of numbered files kept when rotating. Once reached, the
+    * numbers are reused from the beginning and the oldest file is overwritten.
+    * @param maxRotatedFiles The maximum amount. If 0, there is no limit.
+    */
+   void setMaxRotatedFiles(int maxRotatedFiles) { mMaxRotatedFiles = maxRotatedFiles; }
+
+   /**
+    * @brief Gets the time based rotation of the log file.
+    * @return The rotation.
+    */
+   LogRotation getRotation() const { return mRotation; }
+
+   /**
+    * @brief setRotation Sets the time based rotation for this destination. The maximum file size still applies.
+    * @param rotation The new rotation.
+    */
+   void setRotation(LogRotation rotation) { mRotation = rotation; }
+
+   /**
+    * @brief Gets the size of the blocks described in the sidecar index.
+    * @return The size in bytes. If 0, the index is disabled.
+    */
+   int getIndexBlockSize() const { return mIndexBlockSize; }
+
+   /**
+    * @brief setIndexBlockSize Enables the sidecar index written next to the log file (see QLoggerIndex). Every block
+    * of the given size gets an entry with its position, its time range and the levels of its messages, so the tools
+    * can jump to a time range without reading the whole file.
+    * @param blockSize The size in bytes. If 0, the index is disabled.
+    */
+   void setIndexBlockSize(int blockSize) { mIndexBlockSize = blockSize; }
+
+   /**
+    * @brief Gets the time that the writer waits for more messages before writing a batch.
+    * @return The time in microseconds. If 0, the messages are written as soon as the writer wakes up.
+    */
+   int getBatchDelay() const;
+
+   /**
+    * @brief setBatchDelay Sets the time that the writer waits for more messages after waking up, so it writes fewer
+    * and larger batches. It trades latency for throughput: the wait ends early if the batch is already large or if
+    * an Error or Fatal message arrives.
+    * @param microseconds The time in microseconds. If 0, the messages are written as soon as the writer wakes up.
+    */
+   void setBatchDelay(int microseconds);
+
    /**
     * @brief getMessageOptions Gets the current message options.
     * @return The current options
@@ -109,18 +179,44 @@ public:
    void setMessageOptions(LogMessageDisplays messageOptions) { mMessageOptions = messageOptions; }
 
    /**
-    * @brief enqueue Enqueues a message to be written in the destination.
-    * @param date The date and time of the log message.
-    * @param threadId The thread where the message comes from.
-    * @param module The module that writes the message.
+    * @brief enqueue Enqueues a message that has already been formatted with the layout of this destination. If the
+    * layout writes the sequence number, Error and Fatal messages go to a priority queue that the writer drains and
+    * flushes before the other messages. Otherwise they are kept in order and only wake the writer up.
+    * @param text The formatted message without the line break.
     * @param level The log level of the message.
-    * @param function The function that prints the log.
-    * @param fileName The file name that prints the log.
-    * @param line The line of the file name that prints the log.
-    * @param message The message to log.
+    * @param timestamp The time of the message in milliseconds since epoch. If -1, the current time.
+    * @param priority If true, the message goes to the priority queue whatever its level.
+    */
+   void enqueue(const QString &text, LogLevel level = LogLevel::Info, qint64 timestamp = -1, bool priority = false);
+
+   /**
+    * @brief format Formats the record with the message options of this destination.
+    * @param record The record to format.
+    * @return The formatted message without the line break.
+    */
+   QString format(const QLoggerRecord &record) const;
+
+   /**
+    * @brief format Formats the record with the message options of this destination appending it to the given text.
+    * No temporary strings are created, so formatting into a recycled buffer doesn't allocate memory.
+    * @param record The record to format.
+    * @param text The text where the formatted record is appended.
+    */
+   void format(const QLoggerRecord &record, QString &text) const;
+
+   /**
+    * @brief appendFields Appends the fields to the text as " key=value" pairs. String values are quoted and escaped
+    * as JSON strings.
+    * @param text The text where the fields are appended.
+    * @param fields The fields to append.
     */
-   void enqueue(const QDateTime &date, const QString &threadId, const QString &module, LogLevel level,
-                const QString &function, const QString &fileName, int line, const QString &message, ListenerCallback callback = nullptr);
+   static void appendFields(QString &text, const Fields &fields);
+
+   /**
+    * @brief layoutKey Gets a key that identifies the layout used by format. Destinations with the same key produce
+    * the same text for the same record, so it only needs to be formatted once.
+    */
+   quint32 layoutKey() const;
 
    /**
     * @brief Stops the log writer
@@ -134,6 +230,11 @@ public:
     */
    bool isStop() const { return mIsStop; }
 
+   /**
+    * @brief isWriterThread Checks if the current thread is the thread of a QLoggerWriter.
+    */
+   static bool isWriterThread();
+
    /**
     * @brief run Overloaded method from QThread used to wait for new messages.
     */
@@ -144,46 +245,187 @@ public:
     */
    void closeDestination();
 
+   /**
+    * @brief setRotationCallback Sets the callback called from the writer thread every time the log file is rotated.
+    * @param callback The callback that receives the file name of the rotated file.
+    */
+   void setRotationCallback(std::function<void(const QString &)> callback);
+
+protected:
+   /**
+    * @brief The QueuedMessage struct is a formatted message waiting to be written.
+    */
+   struct QueuedMessage
+   {
+      QString text;
+      LogLevel level = LogLevel::Info;
+      qint64 timestamp = 0;
+   };
+
+   /**
+    * @brief Constructor for the destinations that are not files. The queues, the formatting and the writer thread
+    * are shared, and the subclass writes the messages in its own output.
+    * @param destination The identifier of the destination, returned by getFileDestination.
+    * @param level The maximum level that is allowed.
+    * @param messageOptions The message options.
+    */
+   QLoggerWriter(const QString &destination, LogLevel level, LogMessageDisplays messageOptions);
+
+   /**
+    * @brief Writes the messages in the destination. If the file is rotated, it prints a first line with the
+    * information of the old file.
+    *
+    * @param messages The formatted messages to write. Empty if the writer woke up because idleTimeout expired.
+    */
+   virtual void write(const QVector<QueuedMessage> &messages);
+
+   /**
+    * @brief closeOutput Closes the destination once all the messages have been written.
+    */
+   virtual void closeOutput();
+
+   /**
+    * @brief idleTimeout Gets the time that the writer waits for new messages before it calls write with no
+    * messages. Destinations that have to retry their output return a finite time.
+    */
+   virtual unsigned long idleTimeout() const;
+
 private:
    bool mQuit = false;
    bool mIsStop = false;
+   bool mIsWaiting = false; //! @note The producers only wake the writer up if it is waiting
+   bool mIsLingering = false;
+   bool mHasUrgentMessages = false; //! @note Error or Fatal messages kept in order in mMessages
+   int mPriorityBatches = 0; //! @note Consecutive batches taken from mPriorityMessages
+   bool mStartOnFirstMessage = false;
+   QString mStartupMessage;
+   int mBatchDelay = 0;
    QWaitCondition mQueueNotEmpty;
    QString mFileDestinationFolder;
    QString mFileDestination;
+   QString mNextFileDestination;
+   QFile *mFile = nullptr;
+   QFile *mNextFile = nullptr;
+   QTextStream mStream;
+   qint64 mFileSize = 0;
+   bool mIsFileChecked = true; //! @note False after a write error or a rotation, until the file is checked again
+   LogRotation mRotation = LogRotation::Size;
+   LogRotation mScheduledRotation = LogRotation::Size;
+   qint64 mNextRotationTime = -1;
+   int mIndexBlockSize = 0;
+   QFile *mIndexFile = nullptr;
+   QDataStream mIndexStream;
+   QLoggerIndexEntry mIndexBlock;
+   qint64 mIndexBlockBytes = 0;
    LogFileDisplay mFileSuffixIfFull;
    LogMode mMode;
    LogLevel mLevel;
    int mMaxFileSize = 1024 * 1024; //! @note 1Mio
+   int mMaxRotatedFiles = 0;
+   int mLastFileNumber = -1;
    LogMessageDisplays mMessageOptions;
-   QVector<QString> mMessages;
-   QMutex mutex;
+   QVector<QueuedMessage> mMessages;
+   QVector<QueuedMessage> mPriorityMessages;
+   QVector<QueuedMessage> mWriteBuffer;
+   std::function<void(const QString &)> mRotationCallback;
+   mutable QMutex mutex;
 
    /**
-    * @brief renameFileIfFull Truncates the log file in two. Keeps the filename for the new one and renames the old one
-    * with the timestamp or with a file number.
+    * @brief openFile Opens the log file if it isn't open yet. The file is kept open between writes, and it is only
+    * checked on the disk after a write error or a rotation.
+    *
+    * @return True if the file is open, otherwise false.
+    */
+   bool openFile();
+
+   /**
+    * @brief prepareNextFile Opens the file that replaces the current one when it is rotated. Nothing is opened if
+    * the destination has no size nor time limit.
+    */
+   void prepareNextFile();
+
+   /**
+    * @brief closeFiles Closes the log file and removes the next file that has not been used.
+    */
+   void closeFiles();
+
+   /**
+    * @brief openIndex Opens the sidecar index of the log file. New blocks start at the current end of the file.
+    */
+   void openIndex();
+
+   /**
+    * @brief closeIndex Writes the current block and closes the sidecar index.
+    */
+   void closeIndex();
+
+   /**
+    * @brief indexMessage Adds a written message to the current block of the index and writes the block if it is
+    * full.
+    */
+   void indexMessage(const QueuedMessage &message);
+
+   /**
+    * @brief writeIndexBlock Writes the current block in the index. The next block starts where it ends.
+    */
+   void writeIndexBlock();
+
+   /**
+    * @brief rotateIfNeeded Rotates the log file if it is full or if the rotation period is over. The old file is
+    * renamed with the timestamp or with a file number, the next file takes its name and the old file is closed in
+    * the global thread pool.
     *
     * @return Returns the file name for the old logs.
     */
-   QString renameFileIfFull();
+   QString rotateIfNeeded();
+
+   /**
+    * @brief startWithFirstMessage Starts the deferred writer thread, queueing the startup message first. The mutex
+    * has to be locked.
+    * @param timestamp The time of the startup message.
+    */
+   void startWithFirstMessage(qint64 timestamp);
+
+   /**
+    * @brief formatJson Formats the record as a single line JSON object appending it to the given text.
+    * @param record The record to format.
+    * @param text The text where the formatted record is appended.
+    */
+   void formatJson(const QLoggerRecord &record, QString &text) const;
 
    /**
-    * @brief generateDuplicateFilename
+    * @brief renameOpenFile Renames a file that is open. If the platform doesn't allow it, the file is closed and
+    * opened again.
+    *
+    * @return True if the file was renamed, otherwise false.
+    */
+   static bool renameOpenFile(QFile *file, const QString &from, const QString &to);
+
+   /**
+    * @brief nextRotationTime Gets the time when the current period of the rotation is over.
+    *
+    * @return The time in milliseconds since epoch or -1 if the rotation doesn't depend on the time.
+    */
+   static qint64 nextRotationTime(LogRotation rotation, qint64 now);
+
+   /**
+    * @brief generateNumberedFilename Gets the name for the next rotated file when the suffix is a number. The last
+    * number used is found once and then kept in memory, so the cost doesn't depend on the amount of rotated files.
     *
     * @param fileDestination The file path and name without the extension.
     * @param fileExtension The file extension
-    * @param fileSuffixNumber The file suffix number.
     * @return The complete path of the duplicated file name.
     */
-   static QString generateDuplicateFilename(const QString &fileDestination, const QString &fileExtension,
-                                            int fileSuffixNumber = 1);
+   QString generateNumberedFilename(const QString &fileDestination, const QString &fileExtension);
 
    /**
-    * @brief Writes a message in a file. If the file is full, it truncates it and prints a first line with the
-    * information of the old file.
+    * @brief findLastFileNumber Lists the folder to find the number of the last rotated file.
     *
-    * @param message Pair of values consistent on the date and the message to be log.
+    * @param fileDestination The file path and name without the extension.
+    * @param fileExtension The file extension
+    * @return The last number used. If there are no numbered files, 1.
     */
-   void write(QVector<QString> messages);
+   int findLastFileNumber(const QString &fileDestination, const QString &fileExtension) const;
 };
 
 }
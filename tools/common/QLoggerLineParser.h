@@ -0,0 +1,192 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Maestre
+ **
+ ** LinkedIn: https://www.linkedin.com/in/francescmaestre/
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QDateTime>
+#include <QString>
+#include <QtGlobal>
+
+#include <cstring>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerLine struct stores the fields that the tools need from a line written with the QLogger layout:
+ * [Level][Module][Seconds][#Sequence][Thread]{File:Line} Message
+ * The fields that are not displayed keep their default value.
+ */
+struct QLoggerLine
+{
+   int level = -1; //! @note Value of LogLevel
+   qint64 timestamp = -1; //! @note Seconds since epoch
+   qint64 sequence = -1;
+   const char *module = nullptr;
+   int moduleLength = 0;
+   const char *thread = nullptr;
+   int threadLength = 0;
+};
+
+/**
+ * @brief The QLoggerLineParser namespace contains the parser shared by the command line tools. It works on the raw
+ * bytes of the file, so the tools don't need to convert every line to a QString.
+ */
+namespace QLoggerLineParser
+{
+
+/**
+ * @brief Gets the LogLevel value of a level name or -1 if the text is not a level.
+ */
+inline int levelFromName(const char *name, int length)
+{
+   static const char *const NAMES[] = { "Trace", "Debug", "Info", "Warning", "Error", "Fatal" };
+
+   for (auto i = 0; i < 6; ++i)
+   {
+      if (static_cast<int>(std::strlen(NAMES[i])) == length && std::memcmp(NAMES[i], name, length) == 0)
+         return i;
+   }
+
+   return -1;
+}
+
+/**
+ * @brief Gets the LogLevel value of a level name, ignoring the case, or -1 if the text is not a level.
+ */
+inline int levelFromArgument(const QString &name)
+{
+   static const char *const NAMES[] = { "Trace", "Debug", "Info", "Warning", "Error", "Fatal" };
+
+   for (auto i = 0; i < 6; ++i)
+   {
+      if (name.compare(QLatin1String(NAMES[i]), Qt::CaseInsensitive) == 0)
+         return i;
+   }
+
+   return -1;
+}
+
+/**
+ * @brief Parses a time given as seconds since epoch or as an ISO 8601 date and time.
+ * @return The time in milliseconds since epoch.
+ */
+inline qint64 parseTime(const QString &text, bool *ok)
+{
+   auto isNumber = false;
+   const auto seconds = text.toLongLong(&isNumber);
+
+   if (isNumber)
+   {
+      *ok = true;
+      return seconds * 1000;
+   }
+
+   const auto dateTime = QDateTime::fromString(text, Qt::ISODate);
+   *ok = dateTime.isValid();
+
+   return dateTime.toMSecsSinceEpoch();
+}
+
+/**
+ * @brief Checks if the text only contains digits.
+ */
+inline bool isNumber(const char *text, int length)
+{
+   if (length == 0)
+      return false;
+
+   for (auto i = 0; i < length; ++i)
+   {
+      if (text[i] < '0' || text[i] > '9')
+         return false;
+   }
+
+   return true;
+}
+
+/**
+ * @brief Converts a text that only contains digits to a number.
+ */
+inline qint64 toNumber(const char *text, int length)
+{
+   qint64 value = 0;
+
+   for (auto i = 0; i < length; ++i)
+      value = value * 10 + (text[i] - '0');
+
+   return value;
+}
+
+/**
+ * @brief Parses the fields between brackets at the beginning of a line.
+ * @param begin The first character of the line.
+ * @param end The end of the line, without the line break.
+ * @param line The parsed fields.
+ * @return True if the line starts with a field, false if it is a continuation line or the header written after a
+ * rotation.
+ */
+inline bool parse(const char *begin, const char *end, QLoggerLine &line)
+{
+   line = QLoggerLine();
+
+   auto position = begin;
+   auto fieldIndex = 0;
+
+   while (position < end && *position == '[')
+   {
+      const auto close = static_cast<const char *>(std::memchr(position, ']', end - position));
+
+      if (!close)
+         break;
+
+      const auto field = position + 1;
+      const auto length = static_cast<int>(close - field);
+
+      const auto level = fieldIndex == 0 ? levelFromName(field, length) : -1;
+
+      if (level != -1)
+         line.level = level;
+      else if (length > 1 && field[0] == '#' && isNumber(field + 1, length - 1))
+         line.sequence = toNumber(field + 1, length - 1);
+      else if (line.timestamp == -1 && isNumber(field, length))
+         line.timestamp = toNumber(field, length);
+      else if (!line.module && line.timestamp == -1)
+      {
+         line.module = field;
+         line.moduleLength = length;
+      }
+      else if (!line.thread)
+      {
+         line.thread = field;
+         line.threadLength = length;
+      }
+
+      position = close + 1;
+      ++fieldIndex;
+   }
+
+   return fieldIndex > 0;
+}
+
+}
+
+}
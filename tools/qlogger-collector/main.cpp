@@ -0,0 +1,143 @@
+/**
+ * @file main.cpp
+ * @brief Collects the messages that several processes write in a shared memory ring (see
+ * QLoggerManager::enableSharedMemoryMode) and writes them ordered by time in a single log file.
+ *
+ * @module qlogger-collector
+ */
+#include <QCoreApplication>
+
+#include "QLoggerSharedRing.h"
+#include "QLoggerWriter.h"
+
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <limits>
+
+using namespace QLogger;
+
+namespace
+{
+
+std::atomic<bool> gStop { false };
+
+void requestStop(int)
+{
+   gStop.store(true);
+}
+
+/**
+ * @brief Writes the pending records that are older than the limit, ordered by time. Records of the same process and
+ * millisecond keep the order of their sequence.
+ * @return The amount of records written.
+ */
+int writeOrdered(QVector<QLoggerRecord> &pending, qint64 limit, QLoggerWriter &writer, quint64 &sequence)
+{
+   std::sort(pending.begin(), pending.end(), [](const QLoggerRecord &a, const QLoggerRecord &b) {
+      return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.sequence < b.sequence;
+   });
+
+   auto written = 0;
+
+   for (; written < pending.count() && pending.at(written).timestamp <= limit; ++written)
+   {
+      auto &record = pending[written];
+
+      // The collector numbers the merged stream, so the sequence is unique in the output
+      record.sequence = ++sequence;
+      writer.enqueue(writer.format(record), record.level, record.timestamp);
+   }
+
+   pending.remove(0, written);
+
+   return written;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   QCoreApplication app(argc, argv);
+   QCoreApplication::setApplicationName(QStringLiteral("qlogger-collector"));
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription(QStringLiteral("Writes the messages of the processes that log in shared memory "
+                                                   "mode in a single file ordered by time."));
+   parser.addHelpOption();
+
+   const QCommandLineOption keyOption(QStringLiteral("key"), QStringLiteral("Key of the shared memory."),
+                                      QStringLiteral("key"), QStringLiteral("qlogger"));
+   const QCommandLineOption slotsOption(QStringLiteral("slots"), QStringLiteral("Amount of messages in the ring."),
+                                        QStringLiteral("count"), QStringLiteral("65536"));
+   const QCommandLineOption folderOption(QStringLiteral("folder"), QStringLiteral("Folder of the log file."),
+                                         QStringLiteral("folder"));
+   const QCommandLineOption fileOption(QStringLiteral("file"), QStringLiteral("Name of the log file."),
+                                       QStringLiteral("file"), QStringLiteral("collected.log"));
+   const QCommandLineOption maxFileSizeOption(QStringLiteral("max-file-size"),
+                                              QStringLiteral("Size in bytes that rotates the log file."),
+                                              QStringLiteral("bytes"), QString::number(64 * 1024 * 1024));
+   const QCommandLineOption windowOption(QStringLiteral("window"),
+                                         QStringLiteral("Milliseconds that a message waits for older messages of "
+                                                        "other processes before it is written."),
+                                         QStringLiteral("ms"), QStringLiteral("100"));
+
+   parser.addOptions({ keyOption, slotsOption, folderOption, fileOption, maxFileSizeOption, windowOption });
+   parser.process(app);
+
+   QLoggerSharedRing ring(parser.value(keyOption));
+
+   if (!ring.create(parser.value(slotsOption).toInt()))
+   {
+      std::fprintf(stderr, "qlogger-collector: cannot create the ring: %s\n", qPrintable(ring.getErrorString()));
+      return 1;
+   }
+
+   QLoggerWriter writer(parser.value(fileOption), LogLevel::Trace, parser.value(folderOption), LogMode::OnlyFile,
+                        LogFileDisplay::DateTime, LogMessageDisplay::Default | LogMessageDisplay::Sequence);
+   writer.setMaxFileSize(parser.value(maxFileSizeOption).toInt());
+   writer.start();
+
+   std::signal(SIGINT, requestStop);
+   std::signal(SIGTERM, requestStop);
+
+   const auto window = parser.value(windowOption).toLongLong();
+   QVector<QLoggerRecord> pending;
+   QLoggerRecord record;
+   quint64 sequence = 0;
+
+   while (!gStop.load())
+   {
+      auto drained = 0;
+
+      while (drained < 4096 && ring.pop(record))
+      {
+         pending.append(record);
+         ++drained;
+      }
+
+      if (!pending.isEmpty())
+         writeOrdered(pending, QDateTime::currentMSecsSinceEpoch() - window, writer, sequence);
+
+      if (drained == 0)
+         QThread::msleep(1);
+   }
+
+   while (ring.pop(record))
+      pending.append(record);
+
+   writeOrdered(pending, std::numeric_limits<qint64>::max(), writer, sequence);
+
+   writer.closeDestination();
+   writer.wait();
+
+   std::fprintf(stderr, "qlogger-collector: %llu messages written, %llu dropped\n",
+                static_cast<unsigned long long>(sequence), static_cast<unsigned long long>(ring.getDroppedCount()));
+
+   return 0;
+}
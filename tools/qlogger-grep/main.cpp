@@ -0,0 +1,537 @@
+/**
+ * @file main.cpp
+ * @brief Prints the lines of QLogger files filtered by level, module, thread, time range and text. The files are
+ * memory-mapped and split in chunks that are scanned in parallel. The text, or the module when there is no text, is
+ * searched with SSE2 over the raw bytes, so the fields are only parsed for the lines that can match.
+ *
+ * @module qlogger-grep
+ */
+#include <QCoreApplication>
+
+#include "QLoggerLineParser.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QThread>
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define QLOGGER_GREP_SSE2
+#   include <emmintrin.h>
+#   if defined(_MSC_VER)
+#      include <intrin.h>
+#   endif
+#endif
+
+using namespace QLogger;
+
+namespace
+{
+
+const qint64 CHUNK_SIZE = 16 * 1024 * 1024;
+
+struct Filter
+{
+   qint64 from = std::numeric_limits<qint64>::min(); //! @note Milliseconds since epoch
+   qint64 to = std::numeric_limits<qint64>::max(); //! @note Milliseconds since epoch
+   int level = 0;
+   QByteArray module; //! @note Also matches the modules below it: "net" matches "net.http"
+   QByteArray thread;
+   QByteArray text;
+};
+
+struct MappedFile
+{
+   QString path;
+   QByteArray prefix;
+   std::unique_ptr<QFile> file;
+   QByteArray fallback; //! @note Used when the file cannot be mapped
+   const char *data = nullptr;
+   qint64 size = 0;
+};
+
+struct Chunk
+{
+   const MappedFile *file = nullptr;
+   qint64 begin = 0;
+   qint64 end = 0;
+   QByteArray output;
+   qint64 matches = 0;
+   bool done = false;
+};
+
+#ifdef QLOGGER_GREP_SSE2
+inline int firstBit(unsigned int mask)
+{
+#   if defined(_MSC_VER)
+   unsigned long index;
+   _BitScanForward(&index, mask);
+   return static_cast<int>(index);
+#   else
+   return __builtin_ctz(mask);
+#   endif
+}
+#endif
+
+/**
+ * @brief Finds the first occurrence of a byte, 16 bytes at a time.
+ * @return The position of the byte or end if it is not found.
+ */
+const char *findByte(const char *begin, const char *end, char byte)
+{
+#ifdef QLOGGER_GREP_SSE2
+   const auto needle = _mm_set1_epi8(byte);
+
+   for (; end - begin >= 16; begin += 16)
+   {
+      const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+      const auto mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+
+      if (mask != 0)
+         return begin + firstBit(mask);
+   }
+#endif
+
+   const auto found = static_cast<const char *>(std::memchr(begin, byte, end - begin));
+
+   return found ? found : end;
+}
+
+/**
+ * @brief Finds the first occurrence of a text. The first and the last byte of the text are compared at 16 positions
+ * at a time and the rest of the text is only compared where both match.
+ * @return The position of the text or end if it is not found.
+ */
+const char *findText(const char *begin, const char *end, const QByteArray &text)
+{
+   const auto length = text.size();
+   const auto needle = text.constData();
+
+   if (length == 1)
+      return findByte(begin, end, needle[0]);
+
+#ifdef QLOGGER_GREP_SSE2
+   const auto first = _mm_set1_epi8(needle[0]);
+   const auto last = _mm_set1_epi8(needle[length - 1]);
+
+   for (; end - begin >= length - 1 + 16; begin += 16)
+   {
+      const auto blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+      const auto blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + length - 1));
+      auto mask = static_cast<unsigned int>(
+          _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+
+      while (mask != 0)
+      {
+         const auto candidate = begin + firstBit(mask);
+
+         if (std::memcmp(candidate + 1, needle + 1, length - 2) == 0)
+            return candidate;
+
+         mask &= mask - 1;
+      }
+   }
+#endif
+
+   while (end - begin >= length)
+   {
+      const auto candidate = static_cast<const char *>(std::memchr(begin, needle[0], end - begin - length + 1));
+
+      if (!candidate)
+         break;
+
+      if (std::memcmp(candidate, needle, length) == 0)
+         return candidate;
+
+      begin = candidate + 1;
+   }
+
+   return end;
+}
+
+const char *lineStart(const char *data, const char *position)
+{
+   while (position > data && position[-1] != '\n')
+      --position;
+
+   return position;
+}
+
+bool lineMatches(const QLoggerLine &line, const Filter &filter)
+{
+   if (line.level != -1 && line.level < filter.level)
+      return false;
+
+   if (line.timestamp != -1 && (line.timestamp * 1000 + 999 < filter.from || line.timestamp * 1000 > filter.to))
+      return false;
+
+   if (!filter.module.isEmpty())
+   {
+      const auto length = filter.module.size();
+
+      if (!line.module || line.moduleLength < length || std::memcmp(line.module, filter.module.constData(), length) != 0
+          || (line.moduleLength > length && line.module[length] != '.'))
+         return false;
+   }
+
+   if (!filter.thread.isEmpty()
+       && (line.threadLength != filter.thread.size()
+           || std::memcmp(line.thread, filter.thread.constData(), line.threadLength) != 0))
+      return false;
+
+   return true;
+}
+
+/**
+ * @brief Checks if the entry that contains the line matches the fields of the filter. Continuation lines of a
+ * multi-line message are checked with the line that starts the message.
+ */
+bool entryMatches(const char *data, const char *begin, const char *end, const Filter &filter)
+{
+   QLoggerLine line;
+
+   while (!QLoggerLineParser::parse(begin, end, line))
+   {
+      if (begin == data)
+         return true;
+
+      end = begin - 1;
+      begin = lineStart(data, end);
+   }
+
+   return lineMatches(line, filter);
+}
+
+void appendLine(Chunk &chunk, const char *begin, const char *end)
+{
+   chunk.output.append(chunk.file->prefix);
+   chunk.output.append(begin, static_cast<int>(end - begin));
+   chunk.output.append('\n');
+   ++chunk.matches;
+}
+
+/**
+ * @brief Scans a chunk searching the text first. Only the lines that contain it are parsed.
+ */
+void scanText(Chunk &chunk, const Filter &filter)
+{
+   const auto data = chunk.file->data;
+   const auto end = data + chunk.end;
+   auto position = data + chunk.begin;
+
+   while (position < end)
+   {
+      const auto found = findText(position, end, filter.text);
+
+      if (found == end)
+         break;
+
+      const auto begin = lineStart(data, found);
+      const auto lineEnd = findByte(found, end, '\n');
+
+      if (entryMatches(data, begin, lineEnd, filter))
+         appendLine(chunk, begin, lineEnd);
+
+      position = lineEnd + 1;
+   }
+}
+
+/**
+ * @brief Scans a chunk searching "[module" first, so only the entries of the module are parsed. The whole entry is
+ * printed, including the continuation lines.
+ */
+void scanModule(Chunk &chunk, const Filter &filter, const QByteArray &needle)
+{
+   const auto data = chunk.file->data;
+   const auto end = data + chunk.end;
+   auto position = data + chunk.begin;
+   QLoggerLine line;
+
+   while (position < end)
+   {
+      const auto found = findText(position, end, needle);
+
+      if (found == end)
+         break;
+
+      const auto begin = lineStart(data, found);
+      auto lineEnd = findByte(found, end, '\n');
+
+      if (QLoggerLineParser::parse(begin, lineEnd, line) && lineMatches(line, filter))
+      {
+         appendLine(chunk, begin, lineEnd);
+
+         while (lineEnd < end)
+         {
+            const auto next = lineEnd + 1;
+            const auto nextEnd = findByte(next, end, '\n');
+
+            if (QLoggerLineParser::parse(next, nextEnd, line))
+               break;
+
+            appendLine(chunk, next, nextEnd);
+            lineEnd = nextEnd;
+         }
+      }
+
+      position = lineEnd + 1;
+   }
+}
+
+/**
+ * @brief Scans a chunk line by line. Used when there is neither text nor module to search.
+ */
+void scanLines(Chunk &chunk, const Filter &filter)
+{
+   const auto data = chunk.file->data;
+   const auto end = data + chunk.end;
+   auto position = data + chunk.begin;
+   auto isMatching = position < end ? entryMatches(data, position, findByte(position, end, '\n'), filter) : false;
+   QLoggerLine line;
+
+   while (position < end)
+   {
+      const auto lineEnd = findByte(position, end, '\n');
+
+      if (QLoggerLineParser::parse(position, lineEnd, line))
+         isMatching = lineMatches(line, filter);
+
+      if (isMatching)
+         appendLine(chunk, position, lineEnd);
+
+      position = lineEnd + 1;
+   }
+}
+
+void scanChunk(Chunk &chunk, const Filter &filter, const QByteArray &moduleNeedle)
+{
+   if (!filter.text.isEmpty())
+      scanText(chunk, filter);
+   else if (!moduleNeedle.isEmpty())
+      scanModule(chunk, filter, moduleNeedle);
+   else
+      scanLines(chunk, filter);
+}
+
+bool mapFile(MappedFile &mapped)
+{
+   mapped.file = std::make_unique<QFile>(mapped.path);
+
+   if (!mapped.file->open(QIODevice::ReadOnly))
+   {
+      std::fprintf(stderr, "qlogger-grep: cannot open %s\n", qPrintable(mapped.path));
+      return false;
+   }
+
+   mapped.size = mapped.file->size();
+
+   if (mapped.size == 0)
+      return true;
+
+   if (const auto data = mapped.file->map(0, mapped.size))
+      mapped.data = reinterpret_cast<const char *>(data);
+   else
+   {
+      mapped.fallback = mapped.file->readAll();
+      mapped.data = mapped.fallback.constData();
+   }
+
+   return true;
+}
+
+/**
+ * @brief Splits a file in chunks that end after a line break, so no line is split between two chunks.
+ */
+void addChunks(const MappedFile &mapped, std::vector<Chunk> &chunks)
+{
+   qint64 begin = 0;
+
+   while (begin < mapped.size)
+   {
+      auto end = qMin(begin + CHUNK_SIZE, mapped.size);
+
+      if (end < mapped.size)
+      {
+         const auto data = mapped.data;
+         end = findByte(data + end, data + mapped.size, '\n') - data;
+         end = qMin(end + 1, mapped.size);
+      }
+
+      Chunk chunk;
+      chunk.file = &mapped;
+      chunk.begin = begin;
+      chunk.end = end;
+      chunks.push_back(std::move(chunk));
+
+      begin = end;
+   }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   QCoreApplication app(argc, argv);
+   QCoreApplication::setApplicationName(QStringLiteral("qlogger-grep"));
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription(
+       QStringLiteral("Prints the lines of QLogger files that match the given fields and text. The files are scanned "
+                      "in parallel and only the lines that contain the text are parsed."));
+   parser.addHelpOption();
+
+   const QCommandLineOption textOption(QStringList { QStringLiteral("e"), QStringLiteral("text") },
+                                       QStringLiteral("Text that the lines have to contain."), QStringLiteral("text"));
+   const QCommandLineOption levelOption(QStringLiteral("level"), QStringLiteral("Minimum level of the lines."),
+                                        QStringLiteral("level"), QStringLiteral("Trace"));
+   const QCommandLineOption moduleOption(QStringLiteral("module"),
+                                         QStringLiteral("Module of the lines, including its submodules."),
+                                         QStringLiteral("module"));
+   const QCommandLineOption threadOption(QStringLiteral("thread"), QStringLiteral("Thread id of the lines."),
+                                         QStringLiteral("thread"));
+   const QCommandLineOption fromOption(QStringLiteral("from"),
+                                      QStringLiteral("Start of the range: seconds since epoch or ISO 8601."),
+                                      QStringLiteral("time"));
+   const QCommandLineOption toOption(QStringLiteral("to"),
+                                     QStringLiteral("End of the range: seconds since epoch or ISO 8601."),
+                                     QStringLiteral("time"));
+   const QCommandLineOption countOption(QStringLiteral("count"),
+                                        QStringLiteral("Prints the amount of matching lines of every file."));
+   const QCommandLineOption jobsOption(QStringLiteral("jobs"), QStringLiteral("Amount of threads."),
+                                       QStringLiteral("jobs"), QString::number(QThread::idealThreadCount()));
+
+   parser.addOptions({ textOption, levelOption, moduleOption, threadOption, fromOption, toOption, countOption,
+                       jobsOption });
+   parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("The log files."), QStringLiteral("files..."));
+   parser.process(app);
+
+   Filter filter;
+   auto ok = true;
+
+   if (parser.isSet(fromOption))
+      filter.from = QLoggerLineParser::parseTime(parser.value(fromOption), &ok);
+
+   if (ok && parser.isSet(toOption))
+      filter.to = QLoggerLineParser::parseTime(parser.value(toOption), &ok);
+
+   filter.level = QLoggerLineParser::levelFromArgument(parser.value(levelOption));
+   filter.module = parser.value(moduleOption).toUtf8();
+   filter.thread = parser.value(threadOption).toUtf8();
+   filter.text = parser.value(textOption).toUtf8();
+
+   const auto files = parser.positionalArguments();
+   const auto jobs = qMax(1, parser.value(jobsOption).toInt());
+
+   if (!ok || filter.level == -1 || files.isEmpty() || filter.text.contains('\n'))
+      parser.showHelp(1);
+
+   const auto moduleNeedle = filter.module.isEmpty() ? QByteArray() : '[' + filter.module;
+
+   std::vector<MappedFile> mappedFiles(files.count());
+   std::vector<Chunk> chunks;
+
+   for (auto i = 0; i < files.count(); ++i)
+   {
+      auto &mapped = mappedFiles[i];
+      mapped.path = files.at(i);
+      mapped.prefix = files.count() > 1 && !parser.isSet(countOption) ? mapped.path.toLocal8Bit() + ':' : QByteArray();
+
+      if (mapFile(mapped))
+         addChunks(mapped, chunks);
+   }
+
+   // The workers can only run a few chunks ahead of the output, so the memory used by the results stays bounded
+   const auto window = static_cast<size_t>(jobs) * 2;
+   std::mutex mutex;
+   std::condition_variable condition;
+   size_t nextChunk = 0;
+   size_t printedChunks = 0;
+
+   const auto worker = [&]() {
+      for (;;)
+      {
+         size_t index;
+
+         {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() { return nextChunk >= chunks.size() || nextChunk < printedChunks + window; });
+
+            if (nextChunk >= chunks.size())
+               return;
+
+            index = nextChunk++;
+         }
+
+         scanChunk(chunks[index], filter, moduleNeedle);
+
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            chunks[index].done = true;
+         }
+
+         condition.notify_all();
+      }
+   };
+
+   std::vector<std::thread> threads;
+
+   for (auto i = 0; i < jobs; ++i)
+      threads.emplace_back(worker);
+
+   static char outputBuffer[1 << 20];
+   std::setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+   const MappedFile *countedFile = nullptr;
+   qint64 count = 0;
+
+   const auto printCount = [&]() {
+      if (countedFile)
+         std::printf("%s: %lld\n", qPrintable(countedFile->path), static_cast<long long>(count));
+   };
+
+   for (auto &chunk : chunks)
+   {
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         condition.wait(lock, [&chunk]() { return chunk.done; });
+      }
+
+      if (parser.isSet(countOption))
+      {
+         if (chunk.file != countedFile)
+         {
+            printCount();
+            countedFile = chunk.file;
+            count = 0;
+         }
+
+         count += chunk.matches;
+      }
+      else
+         std::fwrite(chunk.output.constData(), 1, chunk.output.size(), stdout);
+
+      chunk.output = QByteArray();
+
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         ++printedChunks;
+      }
+
+      condition.notify_all();
+   }
+
+   printCount();
+
+   for (auto &thread : threads)
+      thread.join();
+
+   return 0;
+}
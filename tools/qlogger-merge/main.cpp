@@ -0,0 +1,379 @@
+/**
+ * @file main.cpp
+ * @brief Merges the QLogger files of one or more folders in chronological order. The rotated files of a module are
+ * chained through their "Previous log" header and read as a single stream, and all the streams are merged with a
+ * heap on the timestamp and the sequence number of every line. The files are memory-mapped one at a time per
+ * stream, so the memory used doesn't depend on the size of the logs.
+ *
+ * @module qlogger-merge
+ */
+#include <QCoreApplication>
+
+#include "QLoggerLineParser.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <vector>
+
+using namespace QLogger;
+
+namespace
+{
+
+const QByteArray PREVIOUS_LOG = QByteArrayLiteral("Previous log ");
+
+/**
+ * @brief The Stream class reads the entries of a chain of rotated files, from the oldest to the newest. An entry is
+ * a line that starts with a field plus the continuation lines that follow it.
+ */
+class Stream
+{
+public:
+   Stream(const QStringList &files, const QByteArray &label)
+      : mFiles(files)
+      , mLabel(label)
+   {
+   }
+
+   ~Stream() { closeFile(); }
+
+   /**
+    * @brief next Moves to the next entry.
+    * @return False when all the files of the chain have been read.
+    */
+   bool next()
+   {
+      for (;;)
+      {
+         if (mPosition < mEnd)
+         {
+            readEntry();
+            return true;
+         }
+
+         if (!openNextFile())
+            return false;
+      }
+   }
+
+   qint64 timestamp() const noexcept { return mTimestamp; }
+   qint64 sequence() const noexcept { return mSequence; }
+   const char *entry() const noexcept { return mEntry; }
+   qint64 entryLength() const noexcept { return mEntryLength; }
+   const QByteArray &label() const noexcept { return mLabel; }
+
+private:
+   QStringList mFiles;
+   QByteArray mLabel;
+   int mFileIndex = -1;
+   QFile mFile;
+   QByteArray mFallback; //! @note Used when the file cannot be mapped
+   const char *mData = nullptr;
+   const char *mPosition = nullptr;
+   const char *mEnd = nullptr;
+   const char *mEntry = nullptr;
+   qint64 mEntryLength = 0;
+   qint64 mTimestamp = -1;
+   qint64 mSequence = -1;
+
+   static const char *lineEnd(const char *position, const char *end)
+   {
+      const auto found = static_cast<const char *>(std::memchr(position, '\n', end - position));
+
+      return found ? found : end;
+   }
+
+   bool openNextFile()
+   {
+      closeFile();
+
+      while (++mFileIndex < mFiles.count())
+      {
+         mFile.setFileName(mFiles.at(mFileIndex));
+
+         if (!mFile.open(QIODevice::ReadOnly))
+         {
+            std::fprintf(stderr, "qlogger-merge: cannot open %s\n", qPrintable(mFile.fileName()));
+            continue;
+         }
+
+         const auto size = mFile.size();
+
+         if (size == 0)
+         {
+            mFile.close();
+            continue;
+         }
+
+         if (const auto data = mFile.map(0, size))
+            mData = reinterpret_cast<const char *>(data);
+         else
+         {
+            mFallback = mFile.readAll();
+            mData = mFallback.constData();
+         }
+
+         mPosition = mData;
+         mEnd = mData + size;
+
+         // The header of a rotated file is not an entry
+         if (mEnd - mPosition >= PREVIOUS_LOG.size()
+             && std::memcmp(mPosition, PREVIOUS_LOG.constData(), PREVIOUS_LOG.size()) == 0)
+         {
+            mPosition = lineEnd(mPosition, mEnd);
+            mPosition = mPosition < mEnd ? mPosition + 1 : mEnd;
+         }
+
+         return true;
+      }
+
+      return false;
+   }
+
+   void closeFile()
+   {
+      if (mData && mData != mFallback.constData())
+         mFile.unmap(reinterpret_cast<uchar *>(const_cast<char *>(mData)));
+
+      mFallback.clear();
+      mFile.close();
+      mData = mPosition = mEnd = nullptr;
+   }
+
+   void readEntry()
+   {
+      QLoggerLine line;
+      auto end = lineEnd(mPosition, mEnd);
+
+      // Lines without fields keep the time of the entry before them, so the order of the stream doesn't change
+      if (QLoggerLineParser::parse(mPosition, end, line))
+      {
+         if (line.timestamp != -1)
+            mTimestamp = line.timestamp;
+
+         mSequence = line.sequence;
+      }
+
+      mEntry = mPosition;
+
+      // The continuation lines of a multi-line message belong to the same entry
+      while (end < mEnd)
+      {
+         const auto nextEnd = lineEnd(end + 1, mEnd);
+
+         if (QLoggerLineParser::parse(end + 1, nextEnd, line))
+            break;
+
+         end = nextEnd;
+      }
+
+      mEntryLength = end - mEntry;
+      mPosition = end < mEnd ? end + 1 : mEnd;
+   }
+};
+
+/**
+ * @brief Gets the file that the given file was rotated from, or an empty string if it doesn't start with a
+ * "Previous log" header.
+ */
+QString previousFile(const QString &path)
+{
+   QFile file(path);
+
+   if (!file.open(QIODevice::ReadOnly))
+      return QString();
+
+   const auto header = file.readLine(4096).trimmed();
+
+   if (!header.startsWith(PREVIOUS_LOG))
+      return QString();
+
+   return QString::fromLocal8Bit(header.mid(PREVIOUS_LOG.size()));
+}
+
+/**
+ * @brief Gets the log files of the arguments. Folders are expanded to the files they contain, without the sidecar
+ * indexes and the pre-opened next files.
+ */
+QStringList collectFiles(const QStringList &arguments)
+{
+   QStringList files;
+
+   for (const auto &argument : arguments)
+   {
+      const QFileInfo info(argument);
+
+      if (!info.isDir())
+      {
+         files.append(info.absoluteFilePath());
+         continue;
+      }
+
+      const auto entries = QDir(argument).entryInfoList(QDir::Files, QDir::Name);
+
+      for (const auto &entry : entries)
+      {
+         const auto suffix = entry.suffix();
+
+         if (suffix != QLatin1String("idx") && suffix != QLatin1String("next"))
+            files.append(entry.absoluteFilePath());
+      }
+   }
+
+   return files;
+}
+
+/**
+ * @brief Groups the files in chains of rotated files, each one sorted from the oldest to the newest file. The
+ * previous file is matched by name, so the chains are still found if the folder has been moved.
+ */
+QVector<QStringList> buildChains(const QStringList &files)
+{
+   QHash<QString, QString> byName;
+   QHash<QString, QString> previous;
+   QSet<QString> referenced;
+
+   for (const auto &file : files)
+      byName.insert(QFileInfo(file).fileName(), file);
+
+   for (const auto &file : files)
+   {
+      const auto previousName = QFileInfo(previousFile(file)).fileName();
+
+      if (!previousName.isEmpty() && byName.contains(previousName))
+      {
+         previous.insert(file, byName.value(previousName));
+         referenced.insert(byName.value(previousName));
+      }
+   }
+
+   QVector<QStringList> chains;
+   QSet<QString> visited;
+
+   const auto addChain = [&](const QString &newest) {
+      QStringList chain;
+
+      for (auto file = newest; !file.isEmpty() && !visited.contains(file); file = previous.value(file))
+      {
+         visited.insert(file);
+         chain.prepend(file);
+      }
+
+      if (!chain.isEmpty())
+         chains.append(chain);
+   };
+
+   // The newest file of a chain is the one no other file was rotated from
+   for (const auto &file : files)
+   {
+      if (!referenced.contains(file))
+         addChain(file);
+   }
+
+   // Files left are in a cycle, for example after a numbered rotation overwrote an old file
+   for (const auto &file : files)
+      addChain(file);
+
+   return chains;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   QCoreApplication app(argc, argv);
+   QCoreApplication::setApplicationName(QStringLiteral("qlogger-merge"));
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription(
+       QStringLiteral("Merges QLogger files in chronological order. Rotated files are followed through their "
+                      "\"Previous log\" header. Lines are ordered by time and, within the same second, by the "
+                      "sequence number written with LogMessageDisplay::Sequence."));
+   parser.addHelpOption();
+
+   const QCommandLineOption labelOption(QStringLiteral("label"),
+                                        QStringLiteral("Prefixes every line with the name of its newest file."));
+   const QCommandLineOption chainsOption(QStringLiteral("chains"),
+                                         QStringLiteral("Prints the chains of rotated files and exits."));
+
+   parser.addOptions({ labelOption, chainsOption });
+   parser.addPositionalArgument(QStringLiteral("paths"), QStringLiteral("Log folders or files."),
+                                QStringLiteral("paths..."));
+   parser.process(app);
+
+   const auto files = collectFiles(parser.positionalArguments());
+
+   if (files.isEmpty())
+      parser.showHelp(1);
+
+   const auto chains = buildChains(files);
+
+   if (parser.isSet(chainsOption))
+   {
+      for (const auto &chain : chains)
+         std::printf("%s\n", qPrintable(chain.join(QStringLiteral(" -> "))));
+
+      return 0;
+   }
+
+   std::vector<std::unique_ptr<Stream>> streams;
+   streams.reserve(chains.count());
+
+   for (const auto &chain : chains)
+   {
+      const auto label = parser.isSet(labelOption) ? QFileInfo(chain.last()).fileName().toLocal8Bit() + ':'
+                                                   : QByteArray();
+      streams.push_back(std::make_unique<Stream>(chain, label));
+   }
+
+   // Earlier entries first. Equal keys keep the order of the streams, so the output is deterministic
+   const auto later = [&streams](size_t a, size_t b) {
+      const auto &left = *streams[a];
+      const auto &right = *streams[b];
+
+      if (left.timestamp() != right.timestamp())
+         return left.timestamp() > right.timestamp();
+
+      if (left.sequence() != right.sequence())
+         return left.sequence() > right.sequence();
+
+      return a > b;
+   };
+
+   std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+
+   for (size_t i = 0; i < streams.size(); ++i)
+   {
+      if (streams[i]->next())
+         heap.push(i);
+   }
+
+   static char outputBuffer[1 << 20];
+   std::setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+   while (!heap.empty())
+   {
+      const auto index = heap.top();
+      heap.pop();
+
+      const auto &stream = *streams[index];
+
+      std::fwrite(stream.label().constData(), 1, stream.label().size(), stdout);
+      std::fwrite(stream.entry(), 1, stream.entryLength(), stdout);
+      std::fputc('\n', stdout);
+
+      if (streams[index]->next())
+         heap.push(index);
+   }
+
+   return 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file main.cpp
+ * @brief Prints the lines of QLogger files that belong to a time range and have a minimum level. The sidecar index
+ * of each file is used to read only the blocks that can contain matching lines.
+ *
+ * @module qlogger-query
+ */
+#include <QCoreApplication>
+
+#include "QLoggerIndex.h"
+#include "QLoggerLineParser.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+using namespace QLogger;
+
+namespace
+{
+
+struct Query
+{
+   qint64 from = std::numeric_limits<qint64>::min(); //! @note Milliseconds since epoch
+   qint64 to = std::numeric_limits<qint64>::max(); //! @note Milliseconds since epoch
+   int level = 0;
+};
+
+struct Range
+{
+   qint64 offset = 0;
+   qint64 length = 0;
+};
+
+bool blockMatches(const QLoggerIndexEntry &entry, const Query &query)
+{
+   return entry.lastTimestamp >= query.from && entry.firstTimestamp <= query.to && (entry.levels >> query.level) != 0;
+}
+
+/**
+ * @brief Gets the parts of the file that have to be read: the blocks that match the query and the parts of the file
+ * that are not indexed, like the end of a file that is still being written.
+ */
+QVector<Range> rangesToScan(QVector<QLoggerIndexEntry> entries, qint64 fileSize, const Query &query)
+{
+   std::sort(entries.begin(), entries.end(),
+             [](const QLoggerIndexEntry &a, const QLoggerIndexEntry &b) { return a.offset < b.offset; });
+
+   QVector<Range> ranges;
+   qint64 cursor = 0;
+
+   const auto addRange = [&ranges](qint64 offset, qint64 length) {
+      if (!ranges.isEmpty() && ranges.last().offset + ranges.last().length == offset)
+         ranges.last().length += length;
+      else
+         ranges.append({ offset, length });
+   };
+
+   for (const auto &entry : std::as_const(entries))
+   {
+      if (entry.offset >= fileSize)
+         break;
+
+      if (entry.offset > cursor)
+         addRange(cursor, entry.offset - cursor);
+
+      const auto end = qMin(entry.offset + entry.length, fileSize);
+
+      if (end > cursor && blockMatches(entry, query))
+         addRange(qMax(cursor, entry.offset), end - qMax(cursor, entry.offset));
+
+      cursor = qMax(cursor, end);
+   }
+
+   if (cursor < fileSize)
+      addRange(cursor, fileSize - cursor);
+
+   return ranges;
+}
+
+/**
+ * @brief Prints the lines that match the query. Lines that don't start with a field, like the continuation of a
+ * multi-line message, follow the line before them.
+ */
+void printMatchingLines(const char *data, qint64 length, const Query &query, const QByteArray &prefix)
+{
+   const auto end = data + length;
+   auto position = data;
+   auto isMatching = false;
+   QLoggerLine line;
+
+   while (position < end)
+   {
+      auto lineEnd = static_cast<const char *>(std::memchr(position, '\n', end - position));
+
+      if (!lineEnd)
+         lineEnd = end;
+
+      if (QLoggerLineParser::parse(position, lineEnd, line))
+      {
+         const auto timestamp = line.timestamp * 1000;
+
+         isMatching = (line.level == -1 || line.level >= query.level)
+             && (line.timestamp == -1 || (timestamp + 999 >= query.from && timestamp <= query.to));
+      }
+
+      if (isMatching)
+      {
+         std::fwrite(prefix.constData(), 1, prefix.size(), stdout);
+         std::fwrite(position, 1, lineEnd - position, stdout);
+         std::fputc('\n', stdout);
+      }
+
+      position = lineEnd + 1;
+   }
+}
+
+/**
+ * @brief Prints the matching lines of one file.
+ * @return The amount of bytes read.
+ */
+qint64 queryFile(const QString &path, const Query &query, const QByteArray &prefix, bool *hasIndex)
+{
+   QFile file(path);
+
+   if (!file.open(QIODevice::ReadOnly))
+   {
+      std::fprintf(stderr, "qlogger-query: cannot open %s\n", qPrintable(path));
+      return 0;
+   }
+
+   const auto fileSize = file.size();
+   const auto entries = QLoggerIndex::readIndex(QLoggerIndex::indexFilePath(path), hasIndex);
+   const auto ranges = *hasIndex ? rangesToScan(entries, fileSize, query) : QVector<Range> { { 0, fileSize } };
+   qint64 scanned = 0;
+
+   for (const auto &range : ranges)
+   {
+      if (range.length <= 0)
+         continue;
+
+      if (const auto data = file.map(range.offset, range.length))
+      {
+         printMatchingLines(reinterpret_cast<const char *>(data), range.length, query, prefix);
+         file.unmap(data);
+      }
+      else if (file.seek(range.offset))
+      {
+         const auto data = file.read(range.length);
+         printMatchingLines(data.constData(), data.size(), query, prefix);
+      }
+
+      scanned += range.length;
+   }
+
+   return scanned;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+   QCoreApplication app(argc, argv);
+   QCoreApplication::setApplicationName(QStringLiteral("qlogger-query"));
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription(
+       QStringLiteral("Prints the lines of QLogger files in a time range. Files with a sidecar index (.idx) are only "
+                      "read in the blocks that can contain matching lines."));
+   parser.addHelpOption();
+
+   const QCommandLineOption fromOption(QStringLiteral("from"),
+                                       QStringLiteral("Start of the range: seconds since epoch or ISO 8601."),
+                                       QStringLiteral("time"));
+   const QCommandLineOption toOption(QStringLiteral("to"),
+                                     QStringLiteral("End of the range: seconds since epoch or ISO 8601."),
+                                     QStringLiteral("time"));
+   const QCommandLineOption levelOption(QStringLiteral("level"), QStringLiteral("Minimum level of the lines."),
+                                        QStringLiteral("level"), QStringLiteral("Trace"));
+   const QCommandLineOption statsOption(QStringLiteral("stats"),
+                                        QStringLiteral("Prints the amount of bytes read from every file."));
+
+   parser.addOptions({ fromOption, toOption, levelOption, statsOption });
+   parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("The log files."), QStringLiteral("files..."));
+   parser.process(app);
+
+   Query query;
+   auto ok = true;
+
+   if (parser.isSet(fromOption))
+      query.from = QLoggerLineParser::parseTime(parser.value(fromOption), &ok);
+
+   if (ok && parser.isSet(toOption))
+      query.to = QLoggerLineParser::parseTime(parser.value(toOption), &ok);
+
+   query.level = QLoggerLineParser::levelFromArgument(parser.value(levelOption));
+
+   const auto files = parser.positionalArguments();
+
+   if (!ok || query.level == -1 || files.isEmpty())
+      parser.showHelp(1);
+
+   for (const auto &path : files)
+   {
+      const auto prefix = files.count() > 1 ? path.toLocal8Bit() + ':' : QByteArray();
+      auto hasIndex = false;
+      const auto scanned = queryFile(path, query, prefix, &hasIndex);
+
+      if (parser.isSet(statsOption))
+      {
+         std::fprintf(stderr, "%s: read %lld of %lld bytes%s\n", qPrintable(path), static_cast<long long>(scanned),
+                      static_cast<long long>(QFile(path).size()), hasIndex ? "" : " (no index)");
+      }
+   }
+
+   return 0;
+}